@@ -19,6 +19,7 @@
 #include "igotu/commonmessages.h"
 #include "igotu/exception.h"
 #include "igotu/messages.h"
+#include "igotu/ringbuffer.h"
 
 #include "dataconnection.h"
 
@@ -31,6 +32,8 @@
 #include <QMutex>
 #include <QStringList>
 #include <QThread>
+#include <QTime>
+#include <QVector>
 #include <QWaitCondition>
 
 using namespace igotu;
@@ -39,6 +42,41 @@ using namespace igotu;
 #define IGOTU2GPX_USB_MANUALCANCEL
 #endif
 
+// Hotplug notifications are available since libusb 1.0.16
+#if defined(LIBUSB_API_VERSION) && LIBUSB_API_VERSION >= 0x01000102
+#define IGOTU2GPX_USB_HOTPLUG
+#endif
+
+// Physical port path like 1.4.2, empty if not supported by libusb
+static QString devicePort(libusb_device *device)
+{
+#if defined(LIBUSB_API_VERSION) && LIBUSB_API_VERSION >= 0x01000102
+    uint8_t numbers[8];
+    const int count = libusb_get_port_numbers(device, numbers,
+            sizeof(numbers));
+    QStringList result;
+    for (int i = 0; i < count; ++i)
+        result.append(QString::number(numbers[i]));
+    return result.join(QLatin1String("."));
+#else
+    Q_UNUSED(device);
+    return QString();
+#endif
+}
+
+// Connection id that addresses exactly this device
+static QString connectionId(libusb_device *device)
+{
+    // Ports stay the same when a device is plugged in again, addresses do not
+    const QString port = devicePort(device);
+    if (port.isEmpty())
+        return QString().sprintf("0df7:0900,bus=%u,address=%u",
+                libusb_get_bus_number(device),
+                libusb_get_device_address(device));
+    return QString().sprintf("0df7:0900,bus=%u,port=",
+            libusb_get_bus_number(device)) + port;
+}
+
 QString usbErrorMessage(int code)
 {
     switch (code) {
@@ -75,6 +113,39 @@ QString usbErrorMessage(int code)
     }
 }
 
+// Handles all libusb events of a context, completed transfers are signaled
+// with the completion wait condition
+class Libusb10EventThread : public QThread
+{
+public:
+    Libusb10EventThread(libusb_context *context);
+    ~Libusb10EventThread();
+
+    void stop();
+
+    // protects the completed flags of the transfers and error
+    QMutex mutex;
+    QWaitCondition completion;
+    // last error of the event handling, 0 if none
+    int error;
+
+protected:
+    virtual void run();
+
+private:
+    libusb_context *context;
+    bool stopped;
+};
+
+// One interrupt transfer of the receive ring, user_data points to the struct
+struct InterruptTransfer
+{
+    boost::shared_ptr<libusb_transfer> transfer;
+    unsigned char buffer[0x10];
+    Libusb10EventThread *events;
+    int completed;
+};
+
 class Libusb10Connection : public DataConnection
 {
     Q_DECLARE_TR_FUNCTIONS(Libusb10Connection)
@@ -85,6 +156,7 @@ public:
 
     virtual void send(const QByteArray &query);
     virtual QByteArray receive(unsigned expected);
+    virtual unsigned receiveData(char *data, unsigned size);
     virtual void purge();
 
 private:
@@ -92,24 +164,95 @@ private:
     typedef QList<Device> DeviceList;
     DeviceList find_devices(unsigned vendor, unsigned product);
 
+    // Submits up to count transfers at the end of the ring, errors are only
+    // reported if no transfer is in flight
+    void submitTransfers(unsigned count, bool throwOnError);
+    // Waits until the oldest transfer in flight has completed, returns false
+    // on errors
+    bool waitForTransfer(int *error);
+    // Removes the oldest transfer from the ring, copies up to size bytes of
+    // its data to data and appends the rest to the receive buffer; returns
+    // the number of bytes copied to data, received is set to the packet size
+    unsigned takeTransfer(char *data, unsigned size, unsigned *received);
+    // Cancels all transfers in flight, data received until then is appended
+    // to the receive buffer
+    void cancelTransfers();
+
     boost::shared_ptr<libusb_context> context;
     boost::shared_ptr<libusb_device_handle> handle;
-    QByteArray receiveBuffer;
+    boost::scoped_ptr<Libusb10EventThread> events;
+    QVector<boost::shared_ptr<InterruptTransfer> > transfers;
+    unsigned transfersHead;
+    unsigned transfersInFlight;
+    RingBuffer receiveBuffer;
     unsigned timeOut;
     bool hadKernelDriver;
+    qulonglong receivedBytes;
+    qulonglong receiveTime;
+    // Only devices at this location are used, 0 or empty matches all
+    unsigned busNumber;
+    unsigned deviceAddress;
+    QString portPath;
 };
 
+#ifdef IGOTU2GPX_USB_HOTPLUG
+// Handles hotplug events of a context of its own and passes them to the slots
+// of a receiver
+class Libusb10HotplugThread : public QThread
+{
+public:
+    Libusb10HotplugThread(QObject *receiver, const char *arrived,
+            const char *removed);
+    ~Libusb10HotplugThread();
+
+    // Registers the hotplug callback and starts the thread, returns false if
+    // hotplug is not supported
+    bool watch();
+    void stop();
+
+protected:
+    virtual void run();
+
+private:
+    static int LIBUSB_CALL callback(libusb_context *context,
+            libusb_device *device, libusb_hotplug_event event,
+            void *userData);
+
+    boost::shared_ptr<libusb_context> context;
+    libusb_hotplug_callback_handle handle;
+    bool registered;
+    QObject *receiver;
+    QByteArray arrived;
+    QByteArray removed;
+    QMutex mutex;
+    bool stopped;
+};
+#endif
+
 class Libusb10ConnectionCreator :
     public QObject,
-    public DataConnectionCreator
+    public DataConnectionCreator,
+    public DeviceWatcher
 {
     Q_OBJECT
-    Q_INTERFACES(igotu::DataConnectionCreator)
+    Q_INTERFACES(igotu::DataConnectionCreator igotu::DeviceWatcher)
 public:
+    ~Libusb10ConnectionCreator();
+
     virtual QString dataConnection() const;
     virtual int connectionPriority() const;
     virtual QString defaultConnectionId() const;
+    virtual QStringList availableConnectionIds() const;
     virtual DataConnection *createDataConnection(const QString &id) const;
+
+    virtual bool startWatching(QObject *receiver, const char *arrived,
+            const char *removed);
+    virtual void stopWatching();
+
+private:
+#ifdef IGOTU2GPX_USB_HOTPLUG
+    boost::scoped_ptr<Libusb10HotplugThread> hotplug;
+#endif
 };
 
 Q_EXPORT_PLUGIN2(libusb10Connection, Libusb10ConnectionCreator)
@@ -118,13 +261,166 @@ Q_EXPORT_PLUGIN2(libusb10Connection, Libusb10ConnectionCreator)
 //
 // TRANSLATOR igotu::Common
 
+// Libusb10EventThread =========================================================
+
+Libusb10EventThread::Libusb10EventThread(libusb_context *context) :
+    error(0),
+    context(context),
+    stopped(false)
+{
+}
+
+Libusb10EventThread::~Libusb10EventThread()
+{
+    stop();
+}
+
+void Libusb10EventThread::stop()
+{
+    {
+        QMutexLocker locker(&mutex);
+        stopped = true;
+    }
+    wait();
+}
+
+void Libusb10EventThread::run()
+{
+    // Only limits the reaction time to stop(), completions are delivered
+    // immediately
+    timeval tv;
+    tv.tv_sec = 0;
+    tv.tv_usec = 100000;
+
+    Q_FOREVER {
+        {
+            QMutexLocker locker(&mutex);
+            if (stopped)
+                break;
+        }
+        int result = libusb_handle_events_timeout(context, &tv);
+        if (result < 0 && result != LIBUSB_ERROR_INTERRUPTED) {
+            {
+                QMutexLocker locker(&mutex);
+                error = result;
+                completion.wakeAll();
+            }
+            msleep(1);
+        }
+    }
+}
+
+#ifdef IGOTU2GPX_USB_HOTPLUG
+// Libusb10HotplugThread =======================================================
+
+Libusb10HotplugThread::Libusb10HotplugThread(QObject *receiver,
+        const char *arrived, const char *removed) :
+    registered(false),
+    receiver(receiver),
+    arrived(arrived),
+    removed(removed),
+    stopped(false)
+{
+}
+
+Libusb10HotplugThread::~Libusb10HotplugThread()
+{
+    stop();
+}
+
+bool Libusb10HotplugThread::watch()
+{
+    if (!libusb_has_capability(LIBUSB_CAP_HAS_HOTPLUG))
+        return false;
+
+    libusb_context *contextPtr;
+    if (libusb_init(&contextPtr))
+        return false;
+    context.reset(contextPtr, libusb_exit);
+
+    // Devices that are already attached are reported immediately
+    if (libusb_hotplug_register_callback(context.get(),
+                libusb_hotplug_event(LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED |
+                    LIBUSB_HOTPLUG_EVENT_DEVICE_LEFT),
+                LIBUSB_HOTPLUG_ENUMERATE, 0x0df7, 0x0900,
+                LIBUSB_HOTPLUG_MATCH_ANY, &callback, this, &handle))
+        return false;
+    registered = true;
+
+    start();
+    return true;
+}
+
+void Libusb10HotplugThread::stop()
+{
+    {
+        QMutexLocker locker(&mutex);
+        stopped = true;
+    }
+    wait();
+    if (registered) {
+        libusb_hotplug_deregister_callback(context.get(), handle);
+        registered = false;
+    }
+}
+
+void Libusb10HotplugThread::run()
+{
+    // Only limits the reaction time to stop()
+    timeval tv;
+    tv.tv_sec = 0;
+    tv.tv_usec = 100000;
+
+    Q_FOREVER {
+        {
+            QMutexLocker locker(&mutex);
+            if (stopped)
+                break;
+        }
+        if (libusb_handle_events_timeout(context.get(), &tv) < 0)
+            msleep(100);
+    }
+}
+
+int LIBUSB_CALL Libusb10HotplugThread::callback(libusb_context *context,
+        libusb_device *device, libusb_hotplug_event event, void *userData)
+{
+    Q_UNUSED(context);
+
+    Libusb10HotplugThread * const thread =
+        reinterpret_cast<Libusb10HotplugThread*>(userData);
+    QMetaObject::invokeMethod(thread->receiver,
+            event == LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED ?
+                thread->arrived.constData() : thread->removed.constData(),
+            Qt::QueuedConnection, Q_ARG(QString, connectionId(device)));
+    // keep the callback registered
+    return 0;
+}
+#endif
+
 // Libusb10Connection ==========================================================
 
+static void transferCallback(struct libusb_transfer *transfer)
+{
+    InterruptTransfer *interruptTransfer =
+        reinterpret_cast<InterruptTransfer*>(transfer->user_data);
+    QMutexLocker locker(&interruptTransfer->events->mutex);
+    interruptTransfer->completed = 1;
+    interruptTransfer->events->completion.wakeAll();
+}
+
 Libusb10Connection::Libusb10Connection(unsigned vendorId, unsigned productId,
         const QString &flags) :
+    transfersHead(0),
+    transfersInFlight(0),
     timeOut(20),
-    hadKernelDriver(false)
+    hadKernelDriver(false),
+    receivedBytes(0),
+    receiveTime(0),
+    busNumber(0),
+    deviceAddress(0)
 {
+    unsigned transferCount = 4;
     Q_FOREACH (const QString &flag, flags.split(QLatin1Char(','))) {
         if (flag.isEmpty())
             continue;
@@ -132,6 +428,14 @@ Libusb10Connection::Libusb10Connection(unsigned vendorId, unsigned productId,
         const QString value = flag.section(QLatin1Char('='), 1);
         if (name == QLatin1String("timeout"))
             timeOut = value.toUInt();
+        else if (name == QLatin1String("transfers"))
+            transferCount = qMax(1u, value.toUInt());
+        else if (name == QLatin1String("bus"))
+            busNumber = value.toUInt();
+        else if (name == QLatin1String("address"))
+            deviceAddress = value.toUInt();
+        else if (name == QLatin1String("port"))
+            portPath = value;
         else
             qWarning("Unknown flag: %s=%s", qPrintable(name), qPrintable(value));
     }
@@ -186,10 +490,40 @@ Libusb10Connection::Libusb10Connection(unsigned vendorId, unsigned productId,
         throw Exception(Common::tr("Unable to claim interface 0 on device '%1': %2")
                 .arg(QString().sprintf("%04x:%04x", vendorId, productId))
                 .arg(usbErrorMessage(result)));
+
+    events.reset(new Libusb10EventThread(context.get()));
+
+    transfers.resize(transferCount);
+    for (unsigned i = 0; i < transferCount; ++i) {
+        boost::shared_ptr<InterruptTransfer> transfer(new InterruptTransfer);
+        transfer->transfer.reset(libusb_alloc_transfer(0),
+                libusb_free_transfer);
+        if (!transfer->transfer)
+            throw Exception(Common::tr("Unable to read data from device: %1")
+                    .arg(usbErrorMessage(LIBUSB_ERROR_NO_MEM)));
+        libusb_fill_interrupt_transfer(transfer->transfer.get(), handle.get(),
+                0x81, transfer->buffer, 0x10, &transferCallback,
+                transfer.get(), timeOut);
+        transfer->events = events.get();
+        transfer->completed = 1;
+        transfers[i] = transfer;
+    }
+
+    events->start();
 }
 
 Libusb10Connection::~Libusb10Connection()
 {
+    cancelTransfers();
+    events->stop();
+    // Transfers must be freed before the device is closed
+    transfers.clear();
+
+    if (receiveTime > 0)
+        Messages::verboseMessage(tr("Received %1 bytes in %2 ms (%3 bytes/s)")
+                .arg(receivedBytes).arg(receiveTime)
+                .arg(receivedBytes * 1000 / receiveTime));
+
     libusb_release_interface(handle.get(), 0);
     if (hadKernelDriver)
         libusb_attach_kernel_driver(handle.get(), 0);
@@ -211,10 +545,17 @@ Libusb10Connection::DeviceList Libusb10Connection::find_devices
         libusb_device_descriptor descriptor;
         if (libusb_get_device_descriptor(device, &descriptor))
             continue;
-        if (descriptor.idVendor == vendor
-            && (product == 0 || descriptor.idProduct == product))
-            result.append(Device(libusb_ref_device(device),
-                        libusb_unref_device));
+        if (descriptor.idVendor != vendor
+            || (product != 0 && descriptor.idProduct != product))
+            continue;
+        if (busNumber != 0 && libusb_get_bus_number(device) != busNumber)
+            continue;
+        if (deviceAddress != 0 &&
+                libusb_get_device_address(device) != deviceAddress)
+            continue;
+        if (!portPath.isEmpty() && devicePort(device) != portPath)
+            continue;
+        result.append(Device(libusb_ref_device(device), libusb_unref_device));
     }
 
     libusb_free_device_list(list, 1);
@@ -242,123 +583,171 @@ void Libusb10Connection::send(const QByteArray &query)
                 .arg(query.size()));
 }
 
-static void transferCallback(struct libusb_transfer *transfer)
+void Libusb10Connection::submitTransfers(unsigned count, bool throwOnError)
 {
-    int *completed = reinterpret_cast<int*>(transfer->user_data);
-    *completed = 1;
+    const unsigned size = transfers.size();
+    while (count > 0 && transfersInFlight < size) {
+        InterruptTransfer *transfer =
+            transfers[(transfersHead + transfersInFlight) % size].get();
+        {
+            QMutexLocker locker(&events->mutex);
+            transfer->completed = 0;
+        }
+        // Queued transfers wait for their predecessors, so that the time-out
+        // still applies to the idle time of the endpoint
+        transfer->transfer->timeout = timeOut * (transfersInFlight + 1);
+        int result = libusb_submit_transfer(transfer->transfer.get());
+        if (result < 0) {
+            {
+                QMutexLocker locker(&events->mutex);
+                transfer->completed = 1;
+            }
+            if (throwOnError && transfersInFlight == 0)
+                throw Exception(Common::tr("Unable to read data from device: %1")
+                        .arg(usbErrorMessage(result)));
+            // The transfers already in flight still deliver data
+            return;
+        }
+        ++transfersInFlight;
+        --count;
+    }
 }
 
-QByteArray Libusb10Connection::receive(unsigned expected)
+bool Libusb10Connection::waitForTransfer(int *error)
 {
-    unsigned toRead = expected;
-    unsigned emptyCount = 0;
-    int completed;
-    QByteArray result;
-    unsigned char interruptTransferBuffer[0x10];
-    boost::shared_ptr<libusb_transfer> transfer(libusb_alloc_transfer(0),
-            libusb_free_transfer);
-    libusb_fill_interrupt_transfer(transfer.get(), handle.get(), 0x81,
-            interruptTransferBuffer, 0x10, &transferCallback, &completed,
-            timeOut);
-    timeval tv;
-    tv.tv_sec = 0;
-    tv.tv_usec = 1000;
-    while (emptyCount < 3) {
-        unsigned toRemove = qMin(unsigned(receiveBuffer.size()), toRead);
-        result += receiveBuffer.left(toRemove);
-        receiveBuffer.remove(0, toRemove);
-        toRead -= toRemove;
-        if (toRead == 0)
-            break;
-
-        completed = 0;
-        int result = libusb_submit_transfer(transfer.get());
-        if (result < 0)
-            throw Exception(Common::tr("Unable to read data from device: %1")
-                    .arg(usbErrorMessage(result)));
+    InterruptTransfer *transfer = transfers[transfersHead].get();
 
 #ifdef IGOTU2GPX_USB_MANUALCANCEL
-        timeval time;
-        gettimeofday(&time, NULL);
-        const qlonglong cancelTime = qlonglong(time.tv_sec) * 1000000 +
-            time.tv_usec + 2 * timeOut * 1000;
+    QTime timer;
+    timer.start();
 #endif
 
-        while (!completed) {
-            result = libusb_handle_events_timeout(context.get(), &tv);
+    QMutexLocker locker(&events->mutex);
+    while (!transfer->completed) {
+        if (events->error < 0) {
+            *error = events->error;
+            events->error = 0;
+            return false;
+        }
 #ifdef IGOTU2GPX_USB_MANUALCANCEL
-            gettimeofday(&time, NULL);
-            bool manualCancel = cancelTime <= qlonglong(time.tv_sec) * 1000000 +
-                time.tv_usec;
+        const int remaining = int(2 * timeOut) - timer.elapsed();
+        if (remaining <= 0) {
+            // The transfer is completed as cancelled, which counts as a read
+            // without data
+            locker.unlock();
+            libusb_cancel_transfer(transfer->transfer.get());
+            locker.relock();
+            while (!transfer->completed)
+                if (!events->completion.wait(&events->mutex, 1000))
+                    break;
+            break;
+        }
+        events->completion.wait(&events->mutex, remaining);
 #else
-            bool manualCancel = false;
+        events->completion.wait(&events->mutex);
 #endif
-            if (result < 0 || manualCancel) {
-                libusb_cancel_transfer(transfer.get());
-                while (!completed)
-                    if (libusb_handle_events(context.get()) < 0)
-                        break;
-                if (!manualCancel)
-                    throw Exception(Common::tr("Unable to read data from device: %1")
-                            .arg(usbErrorMessage(result)));
-            }
+    }
+
+    return true;
+}
+
+unsigned Libusb10Connection::takeTransfer(char *data, unsigned size,
+        unsigned *received)
+{
+    InterruptTransfer *transfer = transfers[transfersHead].get();
+    transfersHead = (transfersHead + 1) % transfers.size();
+    --transfersInFlight;
+    QMutexLocker locker(&events->mutex);
+    *received = transfer->completed ? transfer->transfer->actual_length : 0;
+    const unsigned copied = qMin(size, *received);
+    if (copied > 0)
+        memcpy(data, transfer->buffer, copied);
+    receiveBuffer.append(reinterpret_cast<char*>(transfer->buffer) + copied,
+            *received - copied);
+    return copied;
+}
+
+void Libusb10Connection::cancelTransfers()
+{
+    const unsigned size = transfers.size();
+    for (unsigned i = 0; i < transfersInFlight; ++i)
+        libusb_cancel_transfer
+            (transfers[(transfersHead + i) % size]->transfer.get());
+    while (transfersInFlight > 0) {
+        {
+            // Do not hang if the event handling is broken
+            QMutexLocker locker(&events->mutex);
+            while (!transfers[transfersHead]->completed)
+                if (!events->completion.wait(&events->mutex, 1000))
+                    break;
         }
+        unsigned received;
+        takeTransfer(NULL, 0, &received);
+    }
+}
+
+QByteArray Libusb10Connection::receive(unsigned expected)
+{
+    QByteArray data(expected, 0);
+    data.resize(receiveData(data.data(), expected));
+    return data;
+}
 
-        unsigned size = transfer->actual_length;
-        if (size == 0)
+unsigned Libusb10Connection::receiveData(char *data, unsigned size)
+{
+    unsigned emptyCount = 0;
+    QTime timer;
+    timer.start();
+
+    unsigned result = receiveBuffer.read(data, size);
+    while (emptyCount < 3 && result < size) {
+        // Keep the endpoint busy, but do not ask for more packets than the
+        // response can have so the next command does not lose its answer
+        const unsigned needed = (size - result + 0x0f) / 0x10;
+        if (needed > transfersInFlight)
+            submitTransfers(needed - transfersInFlight, true);
+
+        int error;
+        if (!waitForTransfer(&error)) {
+            cancelTransfers();
+            throw Exception(Common::tr("Unable to read data from device: %1")
+                    .arg(usbErrorMessage(error)));
+        }
+
+        unsigned received;
+        result += takeTransfer(data + result, size - result, &received);
+        if (received == 0)
             ++emptyCount;
-        receiveBuffer +=
-            QByteArray(reinterpret_cast<char*>(interruptTransferBuffer), size);
     }
 
+    // Leftover bytes stay in the buffer like before
+    cancelTransfers();
+
+    receivedBytes += result;
+    receiveTime += timer.elapsed();
+
     return result;
 }
 
 void Libusb10Connection::purge()
 {
-    int completed;
-    unsigned char interruptTransferBuffer[0x10];
-    boost::shared_ptr<libusb_transfer> transfer(libusb_alloc_transfer(0),
-            libusb_free_transfer);
-    libusb_fill_interrupt_transfer(transfer.get(), handle.get(), 0x81,
-            interruptTransferBuffer, 0x10, &transferCallback, &completed,
-            timeOut);
-    timeval tv;
-    tv.tv_sec = 0;
-    tv.tv_usec = 1000;
-
-    completed = 0;
-    int result = libusb_submit_transfer(transfer.get());
-    if (result < 0)
+    submitTransfers(1, false);
+    if (transfersInFlight == 0)
         return;
 
-#ifdef IGOTU2GPX_USB_MANUALCANCEL
-    timeval time;
-    gettimeofday(&time, NULL);
-    const qlonglong cancelTime = qlonglong(time.tv_sec) * 1000000 +
-        time.tv_usec + 2 * timeOut * 1000;
-#endif
-
-    while (!completed) {
-        result = libusb_handle_events_timeout(context.get(), &tv);
-#ifdef IGOTU2GPX_USB_MANUALCANCEL
-        gettimeofday(&time, NULL);
-        bool manualCancel = cancelTime <= qlonglong(time.tv_sec) * 1000000 +
-            time.tv_usec;
-#else
-        bool manualCancel = false;
-#endif
-        if (result < 0 || manualCancel) {
-            libusb_cancel_transfer(transfer.get());
-            while (!completed)
-                if (libusb_handle_events(context.get()) < 0)
-                    break;
-        }
-    }
+    int error;
+    waitForTransfer(&error);
+    cancelTransfers();
+    receiveBuffer.clear();
 }
 
 // Libusb10ConnectionCreator ===================================================
 
+Libusb10ConnectionCreator::~Libusb10ConnectionCreator()
+{
+    stopWatching();
+}
+
 QString Libusb10ConnectionCreator::dataConnection() const
 {
     return QLatin1String("usb");
@@ -374,6 +763,58 @@ QString Libusb10ConnectionCreator::defaultConnectionId() const
     return QLatin1String("0df7:0900");
 }
 
+QStringList Libusb10ConnectionCreator::availableConnectionIds() const
+{
+    QStringList result;
+
+    libusb_context *contextPtr;
+    if (libusb_init(&contextPtr))
+        return result;
+    boost::shared_ptr<libusb_context> context(contextPtr, libusb_exit);
+
+    libusb_device **list;
+    const ssize_t count = libusb_get_device_list(context.get(), &list);
+    for (ssize_t i = 0; i < count; ++i) {
+        libusb_device *device = list[i];
+        libusb_device_descriptor descriptor;
+        if (libusb_get_device_descriptor(device, &descriptor))
+            continue;
+        if (descriptor.idVendor != 0x0df7 || descriptor.idProduct != 0x0900)
+            continue;
+        result.append(connectionId(device));
+    }
+    if (count >= 0)
+        libusb_free_device_list(list, 1);
+
+    return result;
+}
+
+bool Libusb10ConnectionCreator::startWatching(QObject *receiver,
+        const char *arrived, const char *removed)
+{
+    stopWatching();
+#ifdef IGOTU2GPX_USB_HOTPLUG
+    boost::scoped_ptr<Libusb10HotplugThread> thread
+        (new Libusb10HotplugThread(receiver, arrived, removed));
+    if (!thread->watch())
+        return false;
+    hotplug.swap(thread);
+    return true;
+#else
+    Q_UNUSED(receiver);
+    Q_UNUSED(arrived);
+    Q_UNUSED(removed);
+    return false;
+#endif
+}
+
+void Libusb10ConnectionCreator::stopWatching()
+{
+#ifdef IGOTU2GPX_USB_HOTPLUG
+    hotplug.reset();
+#endif
+}
+
 DataConnection *Libusb10ConnectionCreator::createDataConnection
         (const QString &id) const
 {
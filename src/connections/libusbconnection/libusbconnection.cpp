@@ -19,6 +19,7 @@
 #include "igotu/commonmessages.h"
 #include "igotu/exception.h"
 #include "igotu/messages.h"
+#include "igotu/ringbuffer.h"
 
 #include "dataconnection.h"
 
@@ -40,13 +41,14 @@ public:
 
     virtual void send(const QByteArray &query);
     virtual QByteArray receive(unsigned expected);
+    virtual unsigned receiveData(char *data, unsigned size);
     virtual void purge();
 
 private:
     static QList<struct usb_device*> find_devices(unsigned vendor,
             unsigned product);
 
-    QByteArray receiveBuffer;
+    RingBuffer receiveBuffer;
     boost::shared_ptr<struct usb_dev_handle> handle;
     unsigned timeOut;
 };
@@ -61,6 +63,7 @@ public:
     virtual QString dataConnection() const;
     virtual int connectionPriority() const;
     virtual QString defaultConnectionId() const;
+    virtual QStringList availableConnectionIds() const;
     virtual DataConnection *createDataConnection(const QString &id) const;
 };
 
@@ -178,27 +181,35 @@ void LibusbConnection::send(const QByteArray &query)
 
 QByteArray LibusbConnection::receive(unsigned expected)
 {
-    unsigned toRead = expected;
-    QByteArray data;
+    QByteArray data(expected, 0);
+    data.resize(receiveData(data.data(), expected));
+    return data;
+}
+
+unsigned LibusbConnection::receiveData(char *data, unsigned size)
+{
+    unsigned received = receiveBuffer.read(data, size);
     unsigned emptyCount = 0;
-    while (emptyCount < 3) {
-        unsigned toRemove = qMin(unsigned(receiveBuffer.size()), toRead);
-        data += receiveBuffer.left(toRemove);
-        receiveBuffer.remove(0, toRemove);
-        toRead -= toRemove;
-        if (toRead == 0)
-            break;
-        QByteArray data(0x10, 0);
-        int result = usb_interrupt_read(handle.get(), 0x81, data.data(), 0x10,
-                timeOut);
+    while (emptyCount < 3 && received < size) {
+        // Complete packets go directly to the caller, only the last one
+        // might need to be buffered
+        char packet[0x10];
+        const bool direct = size - received >= 0x10;
+        int result = usb_interrupt_read(handle.get(), 0x81,
+                direct ? data + received : packet, 0x10, timeOut);
         if (result < 0)
             throw Exception(Common::tr("Unable to read data from device: %1")
                 .arg(QString::fromLocal8Bit(strerror(-result))));
         if (result == 0)
             ++emptyCount;
-        receiveBuffer += data.left(result);
+        if (direct) {
+            received += result;
+        } else {
+            receiveBuffer.append(packet, result);
+            received += receiveBuffer.read(data + received, size - received);
+        }
     }
-    return data;
+    return received;
 }
 
 void LibusbConnection::purge()
@@ -224,6 +235,12 @@ QString LibusbConnectionCreator::defaultConnectionId() const
     return QLatin1String("0df7:0900");
 }
 
+QStringList LibusbConnectionCreator::availableConnectionIds() const
+{
+    // only supported with libusb 1.0
+    return QStringList();
+}
+
 DataConnection *LibusbConnectionCreator::createDataConnection
         (const QString &id) const
 {
@@ -0,0 +1,319 @@
+/******************************************************************************
+ * Copyright (C) 2009  Michael Hofmann <mh21@mh21.de>                         *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License along    *
+ * with this program; if not, write to the Free Software Foundation, Inc.,    *
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.                *
+ ******************************************************************************/
+
+#include "igotu/commonmessages.h"
+#include "igotu/exception.h"
+#include "igotu/messages.h"
+#include "igotu/utils.h"
+
+#include "dataconnection.h"
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QRegExp>
+#include <QStringList>
+
+using namespace igotu;
+
+// Data that arrived delay microseconds after the previous event
+struct TraceChunk
+{
+    unsigned delay;
+    QByteArray data;
+};
+
+// One packet sent to the device and everything read until the next one
+struct TraceExchange
+{
+    QByteArray query;
+    unsigned sendDelay;
+    QList<TraceChunk> response;
+};
+
+// Replays the device side of a recorded session. Supported are portmon logs
+// (tab separated and remote/copied with double spaces) and usbmon traces, the
+// same formats as understood by decode-igotu-trace.py.
+class ReplayConnection : public DataConnection
+{
+    Q_DECLARE_TR_FUNCTIONS(ReplayConnection)
+public:
+    ReplayConnection(const QString &fileName, const QString &flags);
+    ~ReplayConnection();
+
+    virtual void send(const QByteArray &query);
+    virtual QByteArray receive(unsigned expected);
+    virtual void purge();
+
+private:
+    void parsePortmon(const QStringList &lines, bool remote);
+    void parseUsbmon(const QStringList &lines);
+    void delay(unsigned usecs);
+
+    static QByteArray decodeHex(const QString &data);
+    static unsigned microseconds(const QString &seconds);
+
+    QList<TraceExchange> exchanges;
+    unsigned position;
+    QList<TraceChunk> pending;
+    QByteArray receiveBuffer;
+    double scale;
+};
+
+class ReplayConnectionCreator :
+    public QObject,
+    public DataConnectionCreator
+{
+    Q_OBJECT
+    Q_INTERFACES(igotu::DataConnectionCreator)
+public:
+    virtual QString dataConnection() const;
+    virtual int connectionPriority() const;
+    virtual QString defaultConnectionId() const;
+    virtual QStringList availableConnectionIds() const;
+    virtual DataConnection *createDataConnection(const QString &id) const;
+};
+
+Q_EXPORT_PLUGIN2(replayConnection, ReplayConnectionCreator)
+
+// Put translations in the right context
+//
+// TRANSLATOR igotu::Common
+
+// ReplayConnection ============================================================
+
+ReplayConnection::ReplayConnection(const QString &fileName,
+        const QString &flags) :
+    position(0),
+    scale(1.0)
+{
+    Q_FOREACH (const QString &flag, flags.split(QLatin1Char(','))) {
+        if (flag.isEmpty())
+            continue;
+        const QString name = flag.section(QLatin1Char('='), 0, 0);
+        const QString value = flag.section(QLatin1Char('='), 1);
+        if (name == QLatin1String("scale"))
+            scale = value.toDouble();
+        else
+            qWarning("Unknown flag: %s=%s", qPrintable(name), qPrintable(value));
+    }
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+        throw Exception(Common::tr("Unable to open device '%1': %2")
+                .arg(fileName, file.errorString()));
+    const QStringList lines = QString::fromLatin1(file.readAll())
+        .remove(QLatin1Char('\r')).split(QLatin1Char('\n'),
+                QString::SkipEmptyParts);
+
+    if (lines.value(0).startsWith(QLatin1Char('[')))
+        parsePortmon(lines.mid(1), true);
+    else if (lines.value(0).split(QLatin1Char('\t')).size() >= 7)
+        parsePortmon(lines, false);
+    else
+        parseUsbmon(lines);
+
+    if (exchanges.isEmpty())
+        throw Exception(tr("No recorded packets found in '%1'")
+                .arg(fileName));
+
+    Messages::verboseMessage(tr("Replaying %1 packets from '%2'")
+            .arg(exchanges.size()).arg(fileName));
+}
+
+ReplayConnection::~ReplayConnection()
+{
+}
+
+void ReplayConnection::parsePortmon(const QStringList &lines, bool remote)
+{
+    QStringList request;
+    Q_FOREACH (const QString &line, lines) {
+        QString command;
+        QString duration;
+        QString data;
+        if (remote) {
+            // request and completion are on separate lines
+            const QStringList tokens = line.trimmed()
+                .split(QLatin1String("  "));
+            if (request.isEmpty()) {
+                request = tokens;
+                continue;
+            }
+            command = request.value(3);
+            duration = tokens.value(1);
+            data = tokens.size() > 3 ? tokens.value(3) : request.value(5);
+            request.clear();
+        } else {
+            const QStringList tokens = line.split(QLatin1Char('\t'));
+            command = tokens.value(3);
+            duration = tokens.value(1);
+            data = tokens.value(6);
+        }
+
+        if (command == QLatin1String("IRP_MJ_WRITE")) {
+            TraceExchange exchange;
+            exchange.query = decodeHex(data);
+            exchange.sendDelay = microseconds(duration);
+            exchanges.append(exchange);
+        } else if (command == QLatin1String("IRP_MJ_READ")) {
+            // NMEA data before the first command is of no interest
+            if (exchanges.isEmpty())
+                continue;
+            TraceChunk chunk;
+            chunk.delay = microseconds(duration);
+            chunk.data = decodeHex(data);
+            exchanges.last().response.append(chunk);
+        }
+    }
+}
+
+void ReplayConnection::parseUsbmon(const QStringList &lines)
+{
+    // tag timestamp(us) event type:bus:device:endpoint ...
+    qulonglong last = 0;
+    Q_FOREACH (const QString &line, lines) {
+        const QStringList tokens = line.simplified().split(QLatin1Char(' '));
+        if (tokens.size() < 4)
+            continue;
+        const qulonglong timestamp = tokens[1].toULongLong();
+        const unsigned delay = last == 0 ? 0 : unsigned(timestamp - last);
+        if (tokens[2] == QLatin1String("S") &&
+                tokens[3].startsWith(QLatin1String("Co:"))) {
+            TraceExchange exchange;
+            exchange.query = decodeHex(QStringList(tokens.mid(12))
+                    .join(QString()));
+            exchange.sendDelay = 0;
+            exchanges.append(exchange);
+        } else if (tokens[2] == QLatin1String("C") &&
+                tokens[3].startsWith(QLatin1String("Co:"))) {
+            if (exchanges.isEmpty())
+                continue;
+            exchanges.last().sendDelay = delay;
+        } else if (tokens[2] == QLatin1String("C") &&
+                tokens[3].startsWith(QLatin1String("Ii:"))) {
+            if (exchanges.isEmpty())
+                continue;
+            TraceChunk chunk;
+            chunk.delay = delay;
+            chunk.data = decodeHex(QStringList(tokens.mid(7))
+                    .join(QString()));
+            exchanges.last().response.append(chunk);
+        } else {
+            continue;
+        }
+        last = timestamp;
+    }
+}
+
+void ReplayConnection::send(const QByteArray &query)
+{
+    receiveBuffer.clear();
+    pending.clear();
+
+    if (query.isEmpty())
+        return;
+
+    // Search forward from the last match first, so that repeated packets
+    // like the second chunk of most commands are matched in order
+    const unsigned count = exchanges.size();
+    for (unsigned i = 0; i < count; ++i) {
+        const unsigned index = (position + i) % count;
+        if (exchanges[index].query != query)
+            continue;
+        position = (index + 1) % count;
+        delay(exchanges[index].sendDelay);
+        pending = exchanges[index].response;
+        return;
+    }
+
+    throw Exception(tr("No recorded response for packet %1")
+            .arg(QString::fromAscii(query.toHex())));
+}
+
+QByteArray ReplayConnection::receive(unsigned expected)
+{
+    // Reads that returned nothing are only waited for if the caller really
+    // wants more data, as the recording driver would have timed out as well
+    while (unsigned(receiveBuffer.size()) < expected && !pending.isEmpty()) {
+        const TraceChunk chunk = pending.takeFirst();
+        delay(chunk.delay);
+        receiveBuffer += chunk.data;
+    }
+
+    const QByteArray result = receiveBuffer.left(expected);
+    receiveBuffer.remove(0, result.size());
+    return result;
+}
+
+void ReplayConnection::purge()
+{
+    receiveBuffer.clear();
+    pending.clear();
+}
+
+void ReplayConnection::delay(unsigned usecs)
+{
+    const unsigned scaled = qRound(usecs * scale);
+    if (scaled > 0)
+        sleepMicroseconds(scaled);
+}
+
+QByteArray ReplayConnection::decodeHex(const QString &data)
+{
+    return QByteArray::fromHex(QString(data)
+            .remove(QRegExp(QLatin1String("Length \\d+:")))
+            .remove(QLatin1Char(' ')).toAscii());
+}
+
+unsigned ReplayConnection::microseconds(const QString &seconds)
+{
+    return qRound(seconds.toDouble() * 1e6);
+}
+
+// ReplayConnectionCreator =====================================================
+
+QString ReplayConnectionCreator::dataConnection() const
+{
+    return QLatin1String("replay");
+}
+
+int ReplayConnectionCreator::connectionPriority() const
+{
+    // never the default connection
+    return 1000;
+}
+
+QString ReplayConnectionCreator::defaultConnectionId() const
+{
+    return QString();
+}
+
+QStringList ReplayConnectionCreator::availableConnectionIds() const
+{
+    // recordings are only replayed on request
+    return QStringList();
+}
+
+DataConnection *ReplayConnectionCreator::createDataConnection
+        (const QString &id) const
+{
+    return new ReplayConnection(id.section(QLatin1Char(','), 0, 0),
+            id.section(QLatin1Char(','), 1));
+}
+
+#include "replayconnection.moc"
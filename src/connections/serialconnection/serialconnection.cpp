@@ -18,6 +18,7 @@
 
 #include "igotu/commonmessages.h"
 #include "igotu/exception.h"
+#include "igotu/utils.h"
 
 #include "dataconnection.h"
 
@@ -26,6 +27,7 @@
 #else
 #include <cerrno>
 #include <fcntl.h>
+#include <poll.h>
 #include <termios.h>
 #include <unistd.h>
 #endif
@@ -43,13 +45,17 @@ public:
 
     virtual void send(const QByteArray &query);
     virtual QByteArray receive(unsigned expected);
+    virtual unsigned receiveData(char *data, unsigned size);
     virtual void purge();
 
 private:
-    QByteArray receiveBuffer;
 #ifdef Q_OS_WIN32
     HANDLE handle;
 #else
+    // Waits until the device is ready for events or the deadline (us) has
+    // passed, returns false on timeout
+    bool waitFor(short events, quint64 deadline);
+
     int handle;
 #endif
 };
@@ -64,6 +70,7 @@ public:
     virtual QString dataConnection() const;
     virtual int connectionPriority() const;
     virtual QString defaultConnectionId() const;
+    virtual QStringList availableConnectionIds() const;
     virtual DataConnection *createDataConnection(const QString &id) const;
 };
 
@@ -85,6 +92,16 @@ QString errorString(DWORD err)
 }
 #endif
 
+#ifndef Q_OS_WIN32
+// Time for the first bytes of a response (ms)
+static const unsigned responseTimeout = 200;
+// Additional time per byte still expected (us), half the speed of the
+// interrupt endpoint of the GPS tracker
+static const unsigned byteTimeout = 125;
+// Time for a packet to be sent (ms)
+static const unsigned sendTimeout = 1000;
+#endif
+
 // Put translations in the right context
 //
 // TRANSLATOR igotu::Common
@@ -120,17 +137,22 @@ SerialConnection::SerialConnection(const QString &port)
 #else
     if (ok)
         device = QString::fromLatin1("/dev/ttyUSB%1").arg(portNumber);
-    handle = open(device.toAscii(), O_RDWR | O_NOCTTY);
+    // Reads and writes never block, timeouts are handled with poll()
+    handle = open(device.toAscii(), O_RDWR | O_NOCTTY | O_NONBLOCK);
     if (handle == -1)
         throw Exception(Common::tr("Unable to open device '%1': %2")
             .arg(device, QString::fromLocal8Bit(strerror(errno))));
     struct termios options;
     tcgetattr(handle, &options);
+    cfmakeraw(&options);
     options.c_cc[VMIN] = 0;
-    options.c_cc[VTIME] = 1;
-    if (tcsetattr(handle, TCSANOW, &options) != 0)
+    options.c_cc[VTIME] = 0;
+    if (tcsetattr(handle, TCSANOW, &options) != 0) {
+        const QString error = QString::fromLocal8Bit(strerror(errno));
+        close(handle);
         throw Exception(Common::tr("Unable to open device '%1': %2")
-            .arg(device, QString::fromLocal8Bit(strerror(errno))));
+            .arg(device, error));
+    }
 #endif
 }
 
@@ -145,8 +167,6 @@ SerialConnection::~SerialConnection()
 
 void SerialConnection::send(const QByteArray &query)
 {
-    receiveBuffer.clear();
-
 #ifdef Q_OS_WIN32
     DWORD result;
 
@@ -154,14 +174,24 @@ void SerialConnection::send(const QByteArray &query)
         throw Exception(Common::tr("Unable to send data to device: %1")
                 .arg(errorString(GetLastError())));
 #else
-    int result;
+    const quint64 deadline = monotonicMicroseconds() + sendTimeout * 1000;
+    int result = 0;
 
-    do {
-        result = write(handle, query.data(), query.size());
-    } while (result == -1 && errno == EINTR);
-    if (result == -1)
-        throw Exception(Common::tr("Unable to send data to device: %1")
-                .arg(QString::fromLocal8Bit(strerror(errno))));
+    while (result < query.size()) {
+        const int sent = write(handle, query.data() + result,
+                query.size() - result);
+        if (sent >= 0) {
+            result += sent;
+            continue;
+        }
+        if (errno == EINTR)
+            continue;
+        if (errno != EAGAIN)
+            throw Exception(Common::tr("Unable to send data to device: %1")
+                    .arg(QString::fromLocal8Bit(strerror(errno))));
+        if (!waitFor(POLLOUT, deadline))
+            break;
+    }
 #endif
     if (unsigned(result) != unsigned(query.size()))
         throw Exception(Common::tr("Unable to send data to device: %1")
@@ -171,36 +201,49 @@ void SerialConnection::send(const QByteArray &query)
 
 QByteArray SerialConnection::receive(unsigned expected)
 {
-    unsigned toRead = expected;
-    QByteArray data;
-    unsigned emptyCount = 0;
-    while (emptyCount < 3) {
-        unsigned toRemove = qMin(unsigned(receiveBuffer.size()), toRead);
-        data += receiveBuffer.left(toRemove);
-        receiveBuffer.remove(0, toRemove);
-        toRead -= toRemove;
-        if (toRead == 0)
-            break;
-        QByteArray data(toRead, 0);
+    QByteArray data(expected, 0);
+    data.resize(receiveData(data.data(), expected));
+    return data;
+}
+
+unsigned SerialConnection::receiveData(char *data, unsigned size)
+{
+    // Reads never ask for more than needed, so nothing needs to be buffered
+    unsigned received = 0;
 #ifdef Q_OS_WIN32
+    unsigned emptyCount = 0;
+    while (emptyCount < 3 && received < size) {
         DWORD result;
-        if (!ReadFile(handle, data.data(), data.size(), &result, NULL))
+        if (!ReadFile(handle, data + received, size - received, &result, NULL))
             throw Exception(Common::tr("Unable to read data from device: %1")
                 .arg(errorString(GetLastError())));
+        if (result == 0)
+            ++emptyCount;
+        received += result;
+    }
 #else
-        int result;
-        do {
-            result = read(handle, data.data(), data.size());
-        } while (result == -1 && errno == EINTR);
-        if (result == -1)
+    // The deadline is moved whenever data arrives, so that large responses
+    // get enough time while short responses do not stall
+    quint64 deadline = monotonicMicroseconds() + responseTimeout * 1000 +
+        quint64(size) * byteTimeout;
+    while (received < size) {
+        const int result = read(handle, data + received, size - received);
+        if (result > 0) {
+            received += result;
+            deadline = monotonicMicroseconds() + responseTimeout * 1000 +
+                quint64(size - received) * byteTimeout;
+            continue;
+        }
+        if (result == -1 && errno == EINTR)
+            continue;
+        if (result == -1 && errno != EAGAIN)
             throw Exception(Common::tr("Unable to read data from device: %1")
                 .arg(QString::fromLocal8Bit(strerror(errno))));
-#endif
-        if (result == 0)
-            ++emptyCount;
-        receiveBuffer += data.left(result);
+        if (!waitFor(POLLIN, deadline))
+            break;
     }
-    return data;
+#endif
+    return received;
 }
 
 void SerialConnection::purge()
@@ -212,6 +255,41 @@ void SerialConnection::purge()
 #endif
 }
 
+#ifndef Q_OS_WIN32
+// Same messages as the callers, waiting is part of their transfer
+static QString waitError(short events, int error)
+{
+    return (events & POLLOUT ?
+            Common::tr("Unable to send data to device: %1") :
+            Common::tr("Unable to read data from device: %1"))
+        .arg(QString::fromLocal8Bit(strerror(error)));
+}
+
+bool SerialConnection::waitFor(short events, quint64 deadline)
+{
+    Q_FOREVER {
+        const quint64 now = monotonicMicroseconds();
+        if (now >= deadline)
+            return false;
+        struct pollfd fd;
+        fd.fd = handle;
+        fd.events = events;
+        fd.revents = 0;
+        // round up, poll() with 0 would spin until the deadline
+        const int result = poll(&fd, 1, (deadline - now + 999) / 1000);
+        if (result == -1 && errno == EINTR)
+            continue;
+        if (result == -1)
+            throw Exception(waitError(events, errno));
+        if (result == 0)
+            return false;
+        if (fd.revents & (POLLERR | POLLHUP | POLLNVAL))
+            throw Exception(waitError(events, ENODEV));
+        return true;
+    }
+}
+#endif
+
 // SerialConnectionCreator =====================================================
 
 QString SerialConnectionCreator::dataConnection() const
@@ -233,6 +311,12 @@ QString SerialConnectionCreator::defaultConnectionId() const
 #endif
 }
 
+QStringList SerialConnectionCreator::availableConnectionIds() const
+{
+    // serial ports can not be probed without disturbing other devices
+    return QStringList();
+}
+
 DataConnection *SerialConnectionCreator::createDataConnection
         (const QString &id) const
 {
@@ -0,0 +1,471 @@
+/******************************************************************************
+ * Copyright (C) 2009  Michael Hofmann <mh21@mh21.de>                         *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License along    *
+ * with this program; if not, write to the Free Software Foundation, Inc.,    *
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.                *
+ ******************************************************************************/
+
+#include "igotu/commonmessages.h"
+#include "igotu/exception.h"
+#include "igotu/igotuconfig.h"
+#include "igotu/ringbuffer.h"
+#include "igotu/utils.h"
+
+#include "dataconnection.h"
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QStringList>
+#include <QTime>
+
+#include <QtEndian>
+
+#include <numeric>
+
+using namespace igotu;
+
+// Emulated GPS tracker that keeps the flash memory in RAM. Commands 0x05 and
+// 0x06 are passed through to the SPI flash chip of the tracker (Macronix, as
+// can be seen from the JEDEC id C2 20 XX returned for ModelCommand), so the
+// emulation is done on the level of flash commands: 03 read, 05 read status,
+// 06 write enable, 02 page program, 20 sector erase and 9f read id.
+class SimConnection : public DataConnection
+{
+    Q_DECLARE_TR_FUNCTIONS(SimConnection)
+public:
+    SimConnection(const QString &model, const QString &flags);
+    ~SimConnection();
+
+    virtual void send(const QByteArray &query);
+    virtual QByteArray receive(unsigned expected);
+    virtual unsigned receiveData(char *data, unsigned size);
+    virtual void purge();
+
+private:
+    void processCommand(const QByteArray &command);
+    void flashRead(const QByteArray &flashCommand, unsigned size);
+    void flashWrite(const QByteArray &flashCommand, unsigned size);
+    void programPage();
+    void respond(int size, const QByteArray &data = QByteArray());
+
+    bool isBusy() const;
+    void startBusy(unsigned msecs);
+    unsigned pointCount() const;
+    void generatePoints(unsigned count);
+    void packetDelay();
+
+    QByteArray flash;
+    QByteArray command;
+    QByteArray programCommand;
+    QByteArray programData;
+    unsigned programSize;
+    RingBuffer receiveBuffer;
+    unsigned serialNumber;
+    unsigned firmwareVersion;
+    unsigned modelId;
+    unsigned latency;
+    unsigned jitter;
+    unsigned eraseTime;
+    unsigned programTime;
+    unsigned maxRead;
+    QTime busyTimer;
+    unsigned busyTime;
+    bool writeEnabled;
+};
+
+class SimConnectionCreator :
+    public QObject,
+    public DataConnectionCreator
+{
+    Q_OBJECT
+    Q_INTERFACES(igotu::DataConnectionCreator)
+public:
+    virtual QString dataConnection() const;
+    virtual int connectionPriority() const;
+    virtual QString defaultConnectionId() const;
+    virtual QStringList availableConnectionIds() const;
+    virtual DataConnection *createDataConnection(const QString &id) const;
+};
+
+Q_EXPORT_PLUGIN2(simConnection, SimConnectionCreator)
+
+// Put translations in the right context
+//
+// TRANSLATOR igotu::Common
+
+// SimConnection ===============================================================
+
+SimConnection::SimConnection(const QString &model, const QString &flags) :
+    programSize(0),
+    serialNumber(0x00209503),
+    firmwareVersion(0x0215),
+    latency(0),
+    jitter(0),
+    eraseTime(0),
+    programTime(0),
+    maxRead(0),
+    busyTime(0),
+    writeEnabled(false)
+{
+    // JEDEC device id of the flash chip, determines the number of 4k blocks
+    unsigned blocks;
+    if (model.isEmpty() || model == QLatin1String("gt120")) {
+        modelId = 0x15;
+        blocks = 0x200;
+    } else if (model == QLatin1String("gt100")) {
+        modelId = 0x13;
+        blocks = 0x080;
+    } else if (model == QLatin1String("gt200")) {
+        modelId = 0x14;
+        blocks = 0x100;
+    } else if (model == QLatin1String("gt200e")) {
+        modelId = 0x17;
+        blocks = 0x800;
+    } else {
+        throw Exception(tr("Unknown tracker model '%1'").arg(model));
+    }
+
+    flash = QByteArray(blocks * 0x1000, '\xff');
+    flash.replace(0, 0x1000, IgotuConfig::gt120DefaultConfig().memoryDump()
+            .left(0x1000));
+
+    Q_FOREACH (const QString &flag, flags.split(QLatin1Char(','))) {
+        if (flag.isEmpty())
+            continue;
+        const QString name = flag.section(QLatin1Char('='), 0, 0);
+        const QString value = flag.section(QLatin1Char('='), 1);
+        if (name == QLatin1String("image")) {
+            QFile file(value);
+            if (!file.open(QIODevice::ReadOnly))
+                throw Exception(Common::tr("Unable to open device '%1': %2")
+                        .arg(value, file.errorString()));
+            const QByteArray image = file.readAll().left(flash.size());
+            flash.replace(0, image.size(), image);
+        } else if (name == QLatin1String("points")) {
+            generatePoints(value.toUInt());
+        } else if (name == QLatin1String("serial")) {
+            serialNumber = value.toUInt();
+        } else if (name == QLatin1String("firmware")) {
+            firmwareVersion = (value.section(QLatin1Char('.'), 0, 0).toUInt()
+                    << 8) | value.section(QLatin1Char('.'), 1, 1).toUInt();
+        } else if (name == QLatin1String("latency")) {
+            latency = value.toUInt();
+        } else if (name == QLatin1String("jitter")) {
+            jitter = value.toUInt();
+        } else if (name == QLatin1String("erasetime")) {
+            eraseTime = value.toUInt();
+        } else if (name == QLatin1String("programtime")) {
+            programTime = value.toUInt();
+        } else if (name == QLatin1String("maxread")) {
+            maxRead = value.toUInt(NULL, 0);
+        } else {
+            qWarning("Unknown flag: %s=%s", qPrintable(name), qPrintable(value));
+        }
+    }
+
+    busyTimer.start();
+}
+
+SimConnection::~SimConnection()
+{
+}
+
+void SimConnection::send(const QByteArray &query)
+{
+    receiveBuffer.clear();
+
+    if (query.size() != 8)
+        throw Exception(tr("Invalid packet size: %1").arg(query.size()));
+
+    // Data chunks of a page program command: 7 data bytes and a checksum each
+    if (programSize > 0) {
+        if (char(std::accumulate(query.data(), query.data() + 8, 0)) != 0) {
+            respond(-2);
+            return;
+        }
+        programData += query.left(qMin(7u, programSize));
+        programSize -= qMin(7u, programSize);
+        respond(0);
+        if (programSize == 0)
+            programPage();
+        return;
+    }
+
+    command += query;
+    if (command.size() < 16) {
+        respond(0);
+        return;
+    }
+
+    const QByteArray complete = command;
+    command.clear();
+    if (char(std::accumulate(complete.data(), complete.data() + 16, 0)) != 0 ||
+            complete[0] != '\x93') {
+        respond(-2);
+        return;
+    }
+    processCommand(complete);
+}
+
+QByteArray SimConnection::receive(unsigned expected)
+{
+    QByteArray result(expected, 0);
+    result.resize(receiveData(result.data(), expected));
+    return result;
+}
+
+unsigned SimConnection::receiveData(char *data, unsigned size)
+{
+    const unsigned result = receiveBuffer.read(data, size);
+
+    // Data arrives in interrupt packets of 16 bytes
+    for (unsigned i = 0; i < (result + 15) / 16; ++i)
+        packetDelay();
+    // A real connection waits for the timeout if there is not enough data
+    if (result < size)
+        packetDelay();
+
+    return result;
+}
+
+void SimConnection::purge()
+{
+    receiveBuffer.clear();
+    packetDelay();
+}
+
+void SimConnection::processCommand(const QByteArray &command)
+{
+    switch (uchar(command[1])) {
+    case 0x01: // NmeaSwitchCommand
+    case 0x08: // UnknownPurgeCommand2
+    case 0x09: // TimeCommand
+    case 0x0c: // UnknownPurgeCommand1
+    case 0x0d: // UnknownWriteCommand3
+        respond(0);
+        break;
+    case 0x0a: { // IdentificationCommand
+        QByteArray data(10, '\0');
+        qToLittleEndian<quint32>(serialNumber,
+                reinterpret_cast<uchar*>(data.data()));
+        qToBigEndian<quint16>(firmwareVersion,
+                reinterpret_cast<uchar*>(data.data() + 4));
+        data[7] = modelId == 0x14 || modelId == 0x17 ? 0x02 : 0x01;
+        data[9] = 0x01;
+        respond(data.size(), data);
+        break;
+    }
+    case 0x0b: { // CountCommand, reads the internal memory of the tracker
+        QByteArray memory(0x100, '\0');
+        qToBigEndian<quint16>(pointCount(),
+                reinterpret_cast<uchar*>(memory.data() + 0x1e));
+        const unsigned size = uchar(command[2]);
+        const unsigned pos = qFromBigEndian<quint16>
+            (reinterpret_cast<const uchar*>(command.data() + 3));
+        const QByteArray data = memory.mid(pos, size).leftJustified(size, '\0');
+        respond(data.size(), data);
+        break;
+    }
+    case 0x05:
+    case 0x06: {
+        const unsigned size = qFromBigEndian<quint16>
+            (reinterpret_cast<const uchar*>(command.data() + 3));
+        const QByteArray flashCommand = command.mid(6, uchar(command[5]));
+        if (flashCommand.isEmpty()) {
+            respond(-2);
+        } else if (command[1] == '\x05') {
+            flashRead(flashCommand, size);
+        } else {
+            flashWrite(flashCommand, size);
+        }
+        break;
+    }
+    default:
+        respond(-2);
+    }
+}
+
+void SimConnection::flashRead(const QByteArray &flashCommand, unsigned size)
+{
+    QByteArray data;
+    switch (uchar(flashCommand[0])) {
+    case 0x03: { // read data
+        if (flashCommand.size() < 4) {
+            respond(-2);
+            return;
+        }
+        const unsigned pos = (uchar(flashCommand[1]) << 16) |
+            (uchar(flashCommand[2]) << 8) | uchar(flashCommand[3]);
+        // Some firmware versions might return less than requested
+        if (maxRead > 0)
+            size = qMin(size, maxRead);
+        data = flash.mid(pos, size);
+        break;
+    }
+    case 0x05: // read status register, WIP and WEL bits
+        data = QByteArray(size, char((isBusy() ? 0x01 : 0x00) |
+                    (writeEnabled ? 0x02 : 0x00)));
+        break;
+    case 0x9f: // read JEDEC id
+        data = QByteArray("\xc2\x20", 2) + char(modelId);
+        break;
+    default:
+        respond(-2);
+        return;
+    }
+    data = data.leftJustified(size, '\xff', true);
+    respond(data.size(), data);
+}
+
+void SimConnection::flashWrite(const QByteArray &flashCommand, unsigned size)
+{
+    const unsigned pos = flashCommand.size() < 4 ? 0 :
+        (uchar(flashCommand[1]) << 16) | (uchar(flashCommand[2]) << 8) |
+        uchar(flashCommand[3]);
+
+    switch (uchar(flashCommand[0])) {
+    case 0x06: // write enable
+        if (!isBusy())
+            writeEnabled = true;
+        break;
+    case 0x04: // write disable
+        writeEnabled = false;
+        break;
+    case 0x20: // sector erase
+        if (writeEnabled && !isBusy() && pos < unsigned(flash.size())) {
+            flash.replace(pos & ~0xfff, 0x1000, QByteArray(0x1000, '\xff'));
+            writeEnabled = false;
+            startBusy(eraseTime);
+        }
+        break;
+    case 0x02: // page program, data follows in separate chunks
+        programCommand = flashCommand;
+        programData.clear();
+        programSize = size;
+        break;
+    default:
+        respond(-2);
+        return;
+    }
+    respond(0);
+}
+
+void SimConnection::programPage()
+{
+    const unsigned pos = (uchar(programCommand[1]) << 16) |
+        (uchar(programCommand[2]) << 8) | uchar(programCommand[3]);
+    if (!writeEnabled || isBusy() || pos >= unsigned(flash.size()))
+        return;
+
+    // Programming can only clear bits and wraps around at the page boundary
+    const unsigned page = pos & ~0xff;
+    for (unsigned i = 0; i < unsigned(programData.size()); ++i) {
+        const unsigned index = page + ((pos + i) & 0xff);
+        flash[index] = char(flash.at(index) & programData.at(i));
+    }
+    writeEnabled = false;
+    startBusy(programTime);
+}
+
+void SimConnection::respond(int size, const QByteArray &data)
+{
+    QByteArray header(3, '\x93');
+    qToBigEndian<qint16>(size, reinterpret_cast<uchar*>(header.data() + 1));
+    receiveBuffer.append(header);
+    receiveBuffer.append(data);
+}
+
+bool SimConnection::isBusy() const
+{
+    return unsigned(busyTimer.elapsed()) < busyTime;
+}
+
+void SimConnection::startBusy(unsigned msecs)
+{
+    busyTimer.restart();
+    busyTime = msecs;
+}
+
+unsigned SimConnection::pointCount() const
+{
+    const QByteArray empty(0x20, '\xff');
+    unsigned result = 0;
+    for (unsigned pos = 0x1000; pos + 0x20 <= unsigned(flash.size());
+            pos += 0x20, ++result)
+        if (flash.mid(pos, 0x20) == empty)
+            break;
+    return qMin(result, 0xffffu);
+}
+
+void SimConnection::generatePoints(unsigned count)
+{
+    count = qMin(count, (unsigned(flash.size()) - 0x1000) / 0x20);
+    // one point per second, starting at 2010-01-01 00:00 UTC
+    for (unsigned i = 0; i < count; ++i) {
+        QByteArray record(0x20, '\0');
+        uchar * const data = reinterpret_cast<uchar*>(record.data());
+        const unsigned date = (10 << 20) | (1 << 16) |
+            ((1 + i / 86400) << 11) | (((i / 3600) % 24) << 6) |
+            ((i / 60) % 60);
+        qToBigEndian<quint32>(date, data);
+        data[0] = i == 0 ? 0x40 : 0x00;
+        qToBigEndian<quint16>((i % 60) * 1000, data + 0x04);
+        qToBigEndian<quint32>(0x000001f0, data + 0x08);
+        qToBigEndian<qint32>(480000000 + i * 100, data + 0x0c);
+        qToBigEndian<qint32>(110000000 + i * 100, data + 0x10);
+        qToBigEndian<qint32>(50000, data + 0x14);
+        flash.replace(0x1000 + i * 0x20, 0x20, record);
+    }
+}
+
+void SimConnection::packetDelay()
+{
+    if (latency == 0 && jitter == 0)
+        return;
+    sleepMicroseconds(latency + (jitter ? unsigned(qrand()) % (jitter + 1) :
+                0));
+}
+
+// SimConnectionCreator ========================================================
+
+QString SimConnectionCreator::dataConnection() const
+{
+    return QLatin1String("sim");
+}
+
+int SimConnectionCreator::connectionPriority() const
+{
+    // never the default connection
+    return 1000;
+}
+
+QString SimConnectionCreator::defaultConnectionId() const
+{
+    return QLatin1String("gt120");
+}
+
+QStringList SimConnectionCreator::availableConnectionIds() const
+{
+    // emulated trackers are only created on request
+    return QStringList();
+}
+
+DataConnection *SimConnectionCreator::createDataConnection
+        (const QString &id) const
+{
+    return new SimConnection(id.section(QLatin1Char(','), 0, 0).toLower(),
+            id.section(QLatin1Char(','), 1));
+}
+
+#include "simconnection.moc"
@@ -0,0 +1,5 @@
+CLEBS *= buildplugin dataconnection igotu
+TARGET = simconnection
+include(../../../clebs.pri)
+
+SOURCES *= $$files(*.cpp)
@@ -46,6 +46,11 @@ NmeaSwitchCommand::NmeaSwitchCommand(DataConnection *connection, bool enable) :
         setIgnoreProtocolErrors(true);
 }
 
+QString NmeaSwitchCommand::commandName() const
+{
+    return QLatin1String("NmeaSwitchCommand");
+}
+
 QByteArray NmeaSwitchCommand::sendAndReceive()
 {
     if (!enable)
@@ -62,6 +67,11 @@ IdentificationCommand::IdentificationCommand(DataConnection *connection) :
     setCommand(command);
 }
 
+QString IdentificationCommand::commandName() const
+{
+    return QLatin1String("IdentificationCommand");
+}
+
 QByteArray IdentificationCommand::sendAndReceive()
 {
     const QByteArray result = IgotuCommand::sendAndReceive();
@@ -98,6 +108,11 @@ ModelCommand::ModelCommand(DataConnection *connection) :
     setCommand(command);
 }
 
+QString ModelCommand::commandName() const
+{
+    return QLatin1String("ModelCommand");
+}
+
 QByteArray ModelCommand::sendAndReceive()
 {
     const QByteArray result = IgotuCommand::sendAndReceive();
@@ -154,6 +169,11 @@ CountCommand::CountCommand(DataConnection *connection) :
     setCommand(command);
 }
 
+QString CountCommand::commandName() const
+{
+    return QLatin1String("CountCommand");
+}
+
 QByteArray CountCommand::sendAndReceive()
 {
     const QByteArray result = IgotuCommand::sendAndReceive();
@@ -172,7 +192,7 @@ unsigned CountCommand::trackPointCount() const
 // ReadCommand =================================================================
 
 ReadCommand::ReadCommand(DataConnection *connection, unsigned pos,
-        unsigned size) :
+        unsigned size, char *target) :
     IgotuCommand(connection),
     size(size)
 {
@@ -183,13 +203,21 @@ ReadCommand::ReadCommand(DataConnection *connection, unsigned pos,
     command[8] = (pos >> 0x08) & 0xff;
     command[9] = (pos >> 0x00) & 0xff;
     setCommand(command);
+
+    if (target)
+        setResponseBuffer(target, size);
+}
+
+QString ReadCommand::commandName() const
+{
+    return QLatin1String("ReadCommand");
 }
 
 QByteArray ReadCommand::sendAndReceive()
 {
     result = IgotuCommand::sendAndReceive();
-    if (unsigned(result.size()) < size)
-        throw Exception(IgotuCommand::tr("Wrong response length"));
+    if (unsigned(result.size()) != size)
+        throw IgotuProtocolError(IgotuCommand::tr("Wrong response length"));
     return result;
 }
 
@@ -217,11 +245,15 @@ WriteCommand::WriteCommand(DataConnection *connection, unsigned writeMode,
     setReceiveRemainder(false);
 }
 
+QString WriteCommand::commandName() const
+{
+    return QLatin1String("WriteCommand");
+}
+
 QByteArray WriteCommand::sendAndReceive()
 {
     IgotuCommand::sendAndReceive();
-    for (unsigned i = 0; i < (unsigned(data.size()) + 6) / 7; ++i)
-        IgotuCommand(connection(), data.mid(i * 7, 7)).sendAndReceive();
+    sendPayload(data);
     return QByteArray();
 }
 
@@ -236,6 +268,11 @@ UnknownWriteCommand1::UnknownWriteCommand1(DataConnection *connection,
     setCommand(command);
 }
 
+QString UnknownWriteCommand1::commandName() const
+{
+    return QLatin1String("UnknownWriteCommand1");
+}
+
 QByteArray UnknownWriteCommand1::sendAndReceive()
 {
     const QByteArray result = IgotuCommand::sendAndReceive();
@@ -257,11 +294,16 @@ UnknownWriteCommand2::UnknownWriteCommand2(DataConnection *connection,
     setCommand(command);
 }
 
+QString UnknownWriteCommand2::commandName() const
+{
+    return QLatin1String("UnknownWriteCommand2");
+}
+
 QByteArray UnknownWriteCommand2::sendAndReceive()
 {
     const QByteArray result = IgotuCommand::sendAndReceive();
     if (unsigned(result.size()) != size)
-        throw Exception(IgotuCommand::tr("Wrong response length"));
+        throw IgotuProtocolError(IgotuCommand::tr("Wrong response length"));
     return result;
 }
 
@@ -274,6 +316,11 @@ UnknownWriteCommand3::UnknownWriteCommand3(DataConnection *connection) :
     setCommand(command);
 }
 
+QString UnknownWriteCommand3::commandName() const
+{
+    return QLatin1String("UnknownWriteCommand3");
+}
+
 QByteArray UnknownWriteCommand3::sendAndReceive()
 {
     const QByteArray result = IgotuCommand::sendAndReceive();
@@ -293,6 +340,11 @@ UnknownPurgeCommand1::UnknownPurgeCommand1(DataConnection *connection,
     setCommand(command);
 }
 
+QString UnknownPurgeCommand1::commandName() const
+{
+    return QLatin1String("UnknownPurgeCommand1");
+}
+
 QByteArray UnknownPurgeCommand1::sendAndReceive()
 {
     const QByteArray result = IgotuCommand::sendAndReceive();
@@ -310,6 +362,11 @@ UnknownPurgeCommand2::UnknownPurgeCommand2(DataConnection *connection) :
     setCommand(command);
 }
 
+QString UnknownPurgeCommand2::commandName() const
+{
+    return QLatin1String("UnknownPurgeCommand2");
+}
+
 QByteArray UnknownPurgeCommand2::sendAndReceive()
 {
     const QByteArray result = IgotuCommand::sendAndReceive();
@@ -330,6 +387,11 @@ TimeCommand::TimeCommand(DataConnection *connection, const QTime &time) :
     setCommand(command);
 }
 
+QString TimeCommand::commandName() const
+{
+    return QLatin1String("TimeCommand");
+}
+
 QByteArray TimeCommand::sendAndReceive()
 {
     const QByteArray result = IgotuCommand::sendAndReceive();
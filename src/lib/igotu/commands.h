@@ -32,6 +32,7 @@ public:
     NmeaSwitchCommand(DataConnection *connection, bool enable);
 
     virtual QByteArray sendAndReceive();
+    virtual QString commandName() const;
 
 private:
     bool enable;
@@ -43,6 +44,7 @@ public:
     IdentificationCommand(DataConnection *connection);
 
     virtual QByteArray sendAndReceive();
+    virtual QString commandName() const;
 
     unsigned serialNumber() const;
     unsigned firmwareVersion() const; // 0xAAII AA major II minor
@@ -59,6 +61,7 @@ public:
     ModelCommand(DataConnection *connection);
 
     virtual QByteArray sendAndReceive();
+    virtual QString commandName() const;
 
     enum Model {
         Unknown,
@@ -82,6 +85,7 @@ public:
     CountCommand(DataConnection *connection);
 
     virtual QByteArray sendAndReceive();
+    virtual QString commandName() const;
 
     unsigned trackPointCount() const;
 
@@ -92,9 +96,13 @@ private:
 class IGOTU_EXPORT ReadCommand : public IgotuCommand
 {
 public:
-    ReadCommand(DataConnection *connection, unsigned pos, unsigned size);
+    // If target is given, the data is received directly into it and it must
+    // have room for size bytes
+    ReadCommand(DataConnection *connection, unsigned pos, unsigned size,
+            char *target = NULL);
 
     virtual QByteArray sendAndReceive();
+    virtual QString commandName() const;
 
     QByteArray data() const;
 
@@ -110,6 +118,7 @@ public:
             const QByteArray &data);
 
     virtual QByteArray sendAndReceive();
+    virtual QString commandName() const;
 
 private:
     QByteArray data;
@@ -121,6 +130,7 @@ public:
     TimeCommand(DataConnection *connection, const QTime &time);
 
     virtual QByteArray sendAndReceive();
+    virtual QString commandName() const;
 };
 
 class IGOTU_EXPORT UnknownWriteCommand1 : public IgotuCommand
@@ -129,6 +139,7 @@ public:
     UnknownWriteCommand1(DataConnection *connection, unsigned mode);
 
     virtual QByteArray sendAndReceive();
+    virtual QString commandName() const;
 };
 
 class IGOTU_EXPORT UnknownWriteCommand2 : public IgotuCommand
@@ -137,6 +148,7 @@ public:
     UnknownWriteCommand2(DataConnection *connection, unsigned size);
 
     virtual QByteArray sendAndReceive();
+    virtual QString commandName() const;
 
 private:
     unsigned size;
@@ -148,6 +160,7 @@ public:
     UnknownWriteCommand3(DataConnection *connection);
 
     virtual QByteArray sendAndReceive();
+    virtual QString commandName() const;
 };
 
 class IGOTU_EXPORT UnknownPurgeCommand1 : public IgotuCommand
@@ -156,6 +169,7 @@ public:
     UnknownPurgeCommand1(DataConnection *connection, unsigned mode);
 
     virtual QByteArray sendAndReceive();
+    virtual QString commandName() const;
 };
 
 class IGOTU_EXPORT UnknownPurgeCommand2 : public IgotuCommand
@@ -164,6 +178,7 @@ public:
     UnknownPurgeCommand2(DataConnection *connection);
 
     virtual QByteArray sendAndReceive();
+    virtual QString commandName() const;
 };
 
 } // namespace igotu
@@ -21,8 +21,12 @@
 
 #include "global.h"
 
+#include <QByteArray>
+#include <QStringList>
 #include <QtPlugin>
 
+#include <cstring>
+
 namespace igotu
 {
 
@@ -36,6 +40,16 @@ public:
     virtual void send(const QByteArray &query) = 0;
     virtual QByteArray receive(unsigned expected) = 0;
     virtual void purge() = 0;
+
+    // Receives up to size bytes directly into data, returns the number of
+    // bytes received; connections with their own buffers should override this
+    // to avoid the temporary copy
+    virtual unsigned receiveData(char *data, unsigned size)
+    {
+        const QByteArray result = receive(size);
+        memcpy(data, result.constData(), result.size());
+        return result.size();
+    }
 };
 
 class DataConnectionCreator
@@ -49,12 +63,35 @@ public:
     // lower is better
     virtual int connectionPriority() const = 0;
     virtual QString defaultConnectionId() const = 0;
+    // Ids that address each attached GPS tracker individually, empty if the
+    // connection is unable to enumerate devices
+    virtual QStringList availableConnectionIds() const = 0;
     virtual DataConnection *createDataConnection(const QString &id) const = 0;
 };
 
+// Implemented by data connection creators that are notified by the system
+// when GPS trackers are attached or removed
+class DeviceWatcher
+{
+public:
+    virtual ~DeviceWatcher()
+    {
+    }
+
+    // Invokes the slots arrived(QString) and removed(QString) of receiver
+    // with connection ids as returned by availableConnectionIds(), arrived
+    // also for GPS trackers that are already attached; slots are called from
+    // another thread. Returns false if not supported on this system.
+    virtual bool startWatching(QObject *receiver, const char *arrived,
+            const char *removed) = 0;
+    virtual void stopWatching() = 0;
+};
+
 } // namespace igotu
 
 Q_DECLARE_INTERFACE(igotu::DataConnectionCreator,
-        "de.mh21.igotu2gpx.dataconnection/1.0")
+        "de.mh21.igotu2gpx.dataconnection/1.2")
+Q_DECLARE_INTERFACE(igotu::DeviceWatcher,
+        "de.mh21.igotu2gpx.devicewatcher/1.0")
 
 #endif
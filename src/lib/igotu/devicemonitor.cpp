@@ -0,0 +1,217 @@
+/******************************************************************************
+ * Copyright (C) 2009  Michael Hofmann <mh21@mh21.de>                         *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License along    *
+ * with this program; if not, write to the Free Software Foundation, Inc.,    *
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.                *
+ ******************************************************************************/
+
+#include "dataconnection.h"
+#include "devicemonitor.h"
+#include "pluginloader.h"
+
+#include <QMap>
+#include <QSet>
+#include <QTimer>
+
+#include <boost/shared_ptr.hpp>
+
+namespace igotu
+{
+
+// Receives the notifications of one DeviceWatcher
+class DeviceWatcherReceiver : public QObject
+{
+    Q_OBJECT
+public:
+    DeviceWatcherReceiver(DeviceMonitorPrivate *monitor,
+            const QString &protocol);
+
+public Q_SLOTS:
+    void arrived(const QString &id);
+    void removed(const QString &id);
+
+private:
+    DeviceMonitorPrivate * const monitor;
+    const QString protocol;
+};
+
+class DeviceMonitorPrivate : public QObject
+{
+    Q_OBJECT
+public Q_SLOTS:
+    void poll();
+
+public:
+    // source is the receiver of a watcher or a polled creator
+    void add(const QString &device, const void *source);
+    void remove(const QString &device, const void *source);
+
+    DeviceMonitor *p;
+
+    QTimer timer;
+    // Attached devices and the sources that reported them; several plugins
+    // can share a protocol (e.g. both libusb versions), so a source only
+    // removes the devices it reported itself
+    QMap<QString, QSet<const void*> > devices;
+    QList<boost::shared_ptr<DeviceWatcherReceiver> > receivers;
+    QList<DeviceWatcher*> watchers;
+    // connections that are polled
+    QList<DataConnectionCreator*> polled;
+    bool running;
+};
+
+// DeviceWatcherReceiver =======================================================
+
+DeviceWatcherReceiver::DeviceWatcherReceiver(DeviceMonitorPrivate *monitor,
+        const QString &protocol) :
+    monitor(monitor),
+    protocol(protocol)
+{
+}
+
+void DeviceWatcherReceiver::arrived(const QString &id)
+{
+    monitor->add(protocol + QLatin1Char(':') + id, this);
+}
+
+void DeviceWatcherReceiver::removed(const QString &id)
+{
+    monitor->remove(protocol + QLatin1Char(':') + id, this);
+}
+
+// DeviceMonitorPrivate ========================================================
+
+void DeviceMonitorPrivate::add(const QString &device, const void *source)
+{
+    if (!running)
+        return;
+    const bool known = devices.contains(device);
+    devices[device].insert(source);
+    if (!known)
+        emit p->deviceArrived(device);
+}
+
+void DeviceMonitorPrivate::remove(const QString &device, const void *source)
+{
+    if (!running || !devices.contains(device))
+        return;
+    QSet<const void*> &sources = devices[device];
+    if (!sources.remove(source) || !sources.isEmpty())
+        return;
+    devices.remove(device);
+    emit p->deviceRemoved(device);
+}
+
+void DeviceMonitorPrivate::poll()
+{
+    Q_FOREACH (DataConnectionCreator * const creator, polled) {
+        const QString prefix = creator->dataConnection() + QLatin1Char(':');
+        QSet<QString> attached;
+        Q_FOREACH (const QString &id, creator->availableConnectionIds())
+            attached.insert(prefix + id);
+
+        // Devices of the same protocol reported by other plugins, e.g. the
+        // hotplug watcher of libusb 1.0 next to libusb 0.1 that never lists
+        // devices, are left alone
+        Q_FOREACH (const QString &device, devices.keys())
+            if (devices.value(device).contains(creator) &&
+                    !attached.contains(device))
+                remove(device, creator);
+        Q_FOREACH (const QString &device, attached)
+            add(device, creator);
+    }
+}
+
+// DeviceMonitor ===============================================================
+
+DeviceMonitor::DeviceMonitor(QObject *parent) :
+    QObject(parent),
+    d(new DeviceMonitorPrivate)
+{
+    d->p = this;
+    d->running = false;
+    d->timer.setInterval(1000);
+    QObject::connect(&d->timer, SIGNAL(timeout()), d.get(), SLOT(poll()));
+}
+
+DeviceMonitor::~DeviceMonitor()
+{
+    stop();
+}
+
+void DeviceMonitor::start()
+{
+    if (d->running)
+        return;
+    d->running = true;
+
+    Q_FOREACH (QObject * const plugin, PluginLoader().allAvailablePlugins()) {
+        DataConnectionCreator * const creator =
+            qobject_cast<DataConnectionCreator*>(plugin);
+        if (!creator)
+            continue;
+        DeviceWatcher * const watcher = qobject_cast<DeviceWatcher*>(plugin);
+        if (watcher) {
+            boost::shared_ptr<DeviceWatcherReceiver> receiver
+                (new DeviceWatcherReceiver(d.get(),
+                                           creator->dataConnection()));
+            if (watcher->startWatching(receiver.get(), "arrived",
+                        "removed")) {
+                d->receivers.append(receiver);
+                d->watchers.append(watcher);
+                continue;
+            }
+        }
+        d->polled.append(creator);
+    }
+
+    if (!d->polled.isEmpty()) {
+        d->poll();
+        d->timer.start();
+    }
+}
+
+void DeviceMonitor::stop()
+{
+    if (!d->running)
+        return;
+    d->running = false;
+
+    d->timer.stop();
+    Q_FOREACH (DeviceWatcher * const watcher, d->watchers)
+        watcher->stopWatching();
+    d->watchers.clear();
+    d->receivers.clear();
+    d->polled.clear();
+    d->devices.clear();
+}
+
+QStringList DeviceMonitor::devices() const
+{
+    return d->devices.keys();
+}
+
+unsigned DeviceMonitor::pollInterval() const
+{
+    return d->timer.interval();
+}
+
+void DeviceMonitor::setPollInterval(unsigned msecs)
+{
+    d->timer.setInterval(msecs);
+}
+
+} // namespace igotu
+
+#include "devicemonitor.moc"
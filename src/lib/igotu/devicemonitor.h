@@ -0,0 +1,67 @@
+/******************************************************************************
+ * Copyright (C) 2009  Michael Hofmann <mh21@mh21.de>                         *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License along    *
+ * with this program; if not, write to the Free Software Foundation, Inc.,    *
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.                *
+ ******************************************************************************/
+
+#ifndef _IGOTU2GPX_SRC_IGOTU_DEVICEMONITOR_H_
+#define _IGOTU2GPX_SRC_IGOTU_DEVICEMONITOR_H_
+
+#include "global.h"
+
+#include <boost/scoped_ptr.hpp>
+
+#include <QObject>
+#include <QStringList>
+
+namespace igotu
+{
+
+class DeviceMonitorPrivate;
+
+// Reports GPS trackers that are attached or removed with device strings as
+// used by IgotuControl::setDevice(). Connections that implement DeviceWatcher
+// are notified by the system, all others are polled. A GPS tracker is removed
+// once no connection that reported it lists it any more.
+class IGOTU_EXPORT DeviceMonitor : public QObject
+{
+    Q_OBJECT
+public:
+    DeviceMonitor(QObject *parent = NULL);
+    ~DeviceMonitor();
+
+    // deviceArrived() is also emitted for GPS trackers that are already
+    // attached
+    void start();
+    void stop();
+
+    // currently attached GPS trackers
+    QStringList devices() const;
+
+    // polling interval in ms for connections without hotplug support
+    unsigned pollInterval() const;
+    void setPollInterval(unsigned msecs);
+
+Q_SIGNALS:
+    void deviceArrived(const QString &device);
+    void deviceRemoved(const QString &device);
+
+protected:
+    boost::scoped_ptr<DeviceMonitorPrivate> d;
+};
+
+} // namespace igotu
+
+#endif
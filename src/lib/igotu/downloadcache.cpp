@@ -0,0 +1,139 @@
+/******************************************************************************
+ * Copyright (C) 2009  Michael Hofmann <mh21@mh21.de>                         *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License along    *
+ * with this program; if not, write to the Free Software Foundation, Inc.,    *
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.                *
+ ******************************************************************************/
+
+
+#include "downloadcache.h"
+#include "messages.h"
+#include "paths.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QtEndian>
+
+namespace igotu
+{
+
+// file header: magic, number of cached trackpoints (big endian)
+static const char cacheMagic[] = "IGC1";
+
+// DownloadCache ===============================================================
+
+DownloadCache::DownloadCache(unsigned serialNumber) :
+    serialNumber(serialNumber),
+    pointCount(0)
+{
+}
+
+DownloadCache::~DownloadCache()
+{
+}
+
+QString DownloadCache::fileName() const
+{
+    return Paths::cacheDirectory() + QLatin1Char('/') +
+        QString::number(serialNumber) + QLatin1String(".cache");
+}
+
+bool DownloadCache::load()
+{
+    data.clear();
+    pointCount = 0;
+
+    QFile file(fileName());
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    const QByteArray contents = file.readAll();
+    if (contents.size() < 8 || !contents.startsWith(cacheMagic))
+        return false;
+    const unsigned count = qFromBigEndian<quint32>
+        (reinterpret_cast<const uchar*>(contents.data() + 4));
+    if (unsigned(contents.size() - 8) != 0x1000 + count * 0x20) {
+        Messages::verboseMessage(tr("Invalid download cache '%1'")
+                .arg(file.fileName()));
+        return false;
+    }
+
+    data = contents.mid(8);
+    pointCount = count;
+    return true;
+}
+
+void DownloadCache::save(const QByteArray &contents, unsigned count)
+{
+    // only complete trackpoint blocks
+    count &= ~0x7fu;
+    if (unsigned(contents.size()) < 0x1000 + count * 0x20)
+        return;
+
+    const QString name = fileName();
+    if (!QDir().mkpath(QFileInfo(name).path())) {
+        Messages::verboseMessage(tr("Unable to create cache directory '%1'")
+                .arg(QFileInfo(name).path()));
+        return;
+    }
+
+    // Write to a temporary file first, a partially written cache would be
+    // considered invalid anyway
+    QFile file(name + QLatin1String(".tmp"));
+    QByteArray header(cacheMagic, 4);
+    header.resize(8);
+    qToBigEndian<quint32>(count, reinterpret_cast<uchar*>(header.data() + 4));
+    if (!file.open(QIODevice::WriteOnly) ||
+            file.write(header) != header.size() ||
+            file.write(contents.left(0x1000 + count * 0x20)) !=
+            qint64(0x1000 + count * 0x20) || !file.flush()) {
+        Messages::verboseMessage(tr("Unable to write download cache '%1': %2")
+                .arg(file.fileName(), file.errorString()));
+        file.remove();
+        return;
+    }
+    file.close();
+
+    QFile::remove(name);
+    if (!file.rename(name)) {
+        Messages::verboseMessage(tr("Unable to write download cache '%1': %2")
+                .arg(name, file.errorString()));
+        file.remove();
+    }
+}
+
+void DownloadCache::remove()
+{
+    QFile::remove(fileName());
+    data.clear();
+    pointCount = 0;
+}
+
+QByteArray DownloadCache::contents() const
+{
+    return data;
+}
+
+unsigned DownloadCache::blocks() const
+{
+    return data.size() / 0x1000;
+}
+
+unsigned DownloadCache::count() const
+{
+    return pointCount;
+}
+
+} // namespace igotu
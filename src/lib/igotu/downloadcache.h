@@ -0,0 +1,63 @@
+/******************************************************************************
+ * Copyright (C) 2009  Michael Hofmann <mh21@mh21.de>                         *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License along    *
+ * with this program; if not, write to the Free Software Foundation, Inc.,    *
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.                *
+ ******************************************************************************/
+
+
+#ifndef _IGOTU2GPX_SRC_IGOTU_DOWNLOADCACHE_H_
+#define _IGOTU2GPX_SRC_IGOTU_DOWNLOADCACHE_H_
+
+#include "global.h"
+
+#include <QCoreApplication>
+
+namespace igotu
+{
+
+// Memory dump of a GPS tracker from the last download, stored in the cache
+// directory with the serial number as file name. Only complete blocks of
+// trackpoints are kept, so that new trackpoints never end up in a cached
+// block.
+class IGOTU_EXPORT DownloadCache
+{
+    Q_DECLARE_TR_FUNCTIONS(igotu::DownloadCache)
+public:
+    DownloadCache(unsigned serialNumber);
+    ~DownloadCache();
+
+    // returns false if there is no usable cache file
+    bool load();
+    // errors are only reported as verbose messages
+    void save(const QByteArray &contents, unsigned count);
+    void remove();
+
+    QString fileName() const;
+
+    // cached blocks, the first one is the configuration block
+    QByteArray contents() const;
+    unsigned blocks() const;
+    // number of trackpoints in the cached blocks
+    unsigned count() const;
+
+private:
+    unsigned serialNumber;
+    QByteArray data;
+    unsigned pointCount;
+};
+
+} // namespace igotu
+
+#endif
@@ -20,9 +20,14 @@
 #include "exception.h"
 #include "igotucommand.h"
 #include "messages.h"
+#include "retrypolicy.h"
+#include "timingconnection.h"
+#include "utils.h"
 
+#include <QTime>
 #include <QtEndian>
 
+#include <cstring>
 #include <numeric>
 
 namespace igotu
@@ -32,13 +37,28 @@ class IgotuCommandPrivate
 {
 public:
     unsigned sendCommand(const QByteArray &data);
+    // Sends one 8 byte piece and returns the announced response size
+    int sendPiece(const QByteArray &piece);
     int receiveResponseSize();
     QByteArray receiveResponseRemainder(unsigned size);
+    void receiveResponseRemainder(char *data, unsigned size);
+    // Returns true if the retry policy allows another try after the given
+    // number of errors, delay is set to the time to wait before
+    bool retry(RetryPolicy::ErrorClass errorClass, unsigned errors,
+            unsigned elapsed, unsigned *delay);
+    void waitForRetry(const QString &name, RetryPolicy::ErrorClass errorClass,
+            unsigned delay);
+    // Hex encoding is expensive for large commands, so callers check the
+    // verbosity before
+    void logCommand() const;
 
     DataConnection *connection;
     QByteArray command;
     bool receiveRemainder;
     bool ignoreProtocolErrors;
+    char *responseBuffer;
+    unsigned responseBufferSize;
+    RetryPolicy retryPolicy;
 };
 
 // Put translations in the right context
@@ -71,6 +91,55 @@ QByteArray IgotuCommandPrivate::receiveResponseRemainder(unsigned size)
     return result;
 }
 
+void IgotuCommandPrivate::receiveResponseRemainder(char *data, unsigned size)
+{
+    const unsigned received = connection->receiveData(data, size);
+    if (received != size)
+        throw IgotuProtocolError(IgotuCommand::tr
+                ("Response data too short: expected %1, got %2 bytes")
+                .arg(size).arg(received));
+}
+
+bool IgotuCommandPrivate::retry(RetryPolicy::ErrorClass errorClass,
+        unsigned errors, unsigned elapsed, unsigned *delay)
+{
+    if (errors > retryPolicy.retries(errorClass))
+        return false;
+    *delay = retryPolicy.delay(errors);
+    if (retryPolicy.deadline() > 0 &&
+            elapsed + *delay >= retryPolicy.deadline())
+        return false;
+    return true;
+}
+
+void IgotuCommandPrivate::waitForRetry(const QString &name,
+        RetryPolicy::ErrorClass errorClass, unsigned delay)
+{
+    RetryPolicy::recordRetry(name, errorClass);
+    if (delay == 0)
+        return;
+    if (Messages::verbose() >= 1)
+        Messages::verboseMessage(IgotuCommand::tr("Retrying in %1 ms")
+                .arg(delay));
+    sleepMicroseconds(delay * 1000);
+}
+
+void IgotuCommandPrivate::logCommand() const
+{
+    Messages::verboseMessage(IgotuCommand::tr("Command: %1")
+            .arg(QString::fromAscii(command.toHex())));
+}
+
+int IgotuCommandPrivate::sendPiece(const QByteArray &piece)
+{
+    connection->send(piece);
+    const int responseSize = receiveResponseSize();
+    if (responseSize < 0)
+        throw DeviceException(IgotuCommand::tr("Device responded with "
+                    "error code: %1").arg(responseSize));
+    return responseSize;
+}
+
 unsigned IgotuCommandPrivate::sendCommand(const QByteArray &data)
 {
     QByteArray command(data);
@@ -86,11 +155,7 @@ unsigned IgotuCommandPrivate::sendCommand(const QByteArray &data)
     for (unsigned i = 0; i < pieces; ++i) {
         if (i == 0)
             connection->purge();
-        connection->send(command.mid(i * 8, 8));
-        responseSize = receiveResponseSize();
-        if (responseSize < 0)
-            throw DeviceException(IgotuCommand::tr("Device responded with "
-                        "error code: %1").arg(responseSize));
+        responseSize = sendPiece(command.mid(i * 8, 8));
         if (responseSize != 0 && i + 1 < pieces)
             throw IgotuProtocolError(IgotuCommand::tr
                     ("Non-empty intermediate response packet: %1")
@@ -109,6 +174,9 @@ IgotuCommand::IgotuCommand(DataConnection *connection, const QByteArray
     d->command = command;
     d->receiveRemainder = receiveRemainder;
     d->ignoreProtocolErrors = false;
+    d->responseBuffer = NULL;
+    d->responseBufferSize = 0;
+    d->retryPolicy = RetryPolicy::currentPolicy();
 }
 
 IgotuCommand::~IgotuCommand()
@@ -155,10 +223,35 @@ void IgotuCommand::setIgnoreProtocolErrors(bool value)
     d->ignoreProtocolErrors = value;
 }
 
+void IgotuCommand::setResponseBuffer(char *buffer, unsigned size)
+{
+    d->responseBuffer = buffer;
+    d->responseBufferSize = size;
+}
+
+RetryPolicy IgotuCommand::retryPolicy() const
+{
+    return d->retryPolicy;
+}
+
+void IgotuCommand::setRetryPolicy(const RetryPolicy &policy)
+{
+    d->retryPolicy = policy;
+}
+
+QString IgotuCommand::commandName() const
+{
+    return QLatin1String("IgotuCommand");
+}
+
 QByteArray IgotuCommand::sendAndReceive()
 {
     unsigned protocolErrors = 0;
     unsigned deviceErrors = 0;
+    unsigned delay;
+    QTime timer;
+    timer.start();
+    const TimingConnection::CommandScope scope(this);
     try {
         Q_FOREVER {
             unsigned size;
@@ -166,53 +259,136 @@ QByteArray IgotuCommand::sendAndReceive()
 
             try {
                 size = d->sendCommand(d->command);
-                if (size > 0 && d->receiveRemainder)
-                    remainder = d->receiveResponseRemainder(size);
+                if (size > 0 && d->receiveRemainder) {
+                    if (d->responseBuffer) {
+                        // Reading elsewhere would leave the caller's buffer
+                        // untouched
+                        if (size > d->responseBufferSize)
+                            throw IgotuProtocolError(tr
+                                    ("Response of %1 bytes exceeds the "
+                                     "expected %2 bytes").arg(size)
+                                    .arg(d->responseBufferSize));
+                        d->receiveResponseRemainder(d->responseBuffer, size);
+                        remainder = QByteArray::fromRawData(d->responseBuffer,
+                                size);
+                    } else {
+                        remainder = d->receiveResponseRemainder(size);
+                    }
+                }
             } catch (const IgotuProtocolError &e) {
                 // ignore protocol errors if switched to NMEA mode
                 if (d->ignoreProtocolErrors) {
-                    Messages::verboseMessage(tr("Command: %1")
-                                .arg(QString::fromAscii(d->command.toHex())));
-                    Messages::verboseMessage(tr("Protocol violated (ignored): %1")
+                    if (Messages::verbose() >= 1) {
+                        d->logCommand();
+                        Messages::verboseMessage(tr("Protocol violated "
+                                    "(ignored): %1")
                                 .arg(QString::fromLocal8Bit(e.what())));
+                    }
                     return remainder;
                 }
                 // Assume this was caused by some spurious NMEA messages
                 ++protocolErrors;
-                if (protocolErrors <= 5) {
-                    Messages::verboseMessage(tr("Command: %1")
-                                .arg(QString::fromAscii(d->command.toHex())));
-                    Messages::verboseMessage(tr("Protocol violated : %1")
+                if (d->retry(RetryPolicy::ProtocolError, protocolErrors,
+                            timer.elapsed(), &delay)) {
+                    if (Messages::verbose() >= 1) {
+                        d->logCommand();
+                        Messages::verboseMessage(tr("Protocol violated : %1")
                                 .arg(QString::fromLocal8Bit(e.what())));
+                    }
+                    d->waitForRetry(commandName(), RetryPolicy::ProtocolError,
+                            delay);
                     continue;
                 }
                 throw;
             } catch (const DeviceException &e) {
                 // Device error codes mean we can try again
                 ++deviceErrors;
-                if (deviceErrors <= 3) {
-                    Messages::verboseMessage(tr("Command: %1")
-                                .arg(QString::fromAscii(d->command.toHex())));
-                    Messages::verboseMessage(tr("Device error: %1")
+                if (d->retry(RetryPolicy::DeviceError, deviceErrors,
+                            timer.elapsed(), &delay)) {
+                    if (Messages::verbose() >= 1) {
+                        d->logCommand();
+                        Messages::verboseMessage(tr("Device error: %1")
                                 .arg(QString::fromLocal8Bit(e.what())));
+                    }
+                    d->waitForRetry(commandName(), RetryPolicy::DeviceError,
+                            delay);
                     continue;
                 }
                 throw;
             }
 
-            Messages::verboseMessage(tr("Command: %1")
-                        .arg(QString::fromAscii(d->command.toHex())));
-            Messages::verboseMessage(tr("Result: %1")
+            if (Messages::verbose() >= 1) {
+                d->logCommand();
+                Messages::verboseMessage(tr("Result: %1")
                         .arg(QString::fromAscii(remainder.toHex())));
+            }
             return remainder;
         }
     } catch (const std::exception &e) {
-        Messages::verboseMessage(tr("Command: %1")
-                    .arg(QString::fromAscii(d->command.toHex())));
-        Messages::verboseMessage(tr("Failed: %1")
+        if (Messages::verbose() >= 1) {
+            d->logCommand();
+            Messages::verboseMessage(tr("Failed: %1")
                     .arg(QString::fromLocal8Bit(e.what())));
+        }
         throw;
     }
 }
 
+void IgotuCommand::sendPayload(const QByteArray &payload)
+{
+    const unsigned pieces = (unsigned(payload.size()) + 6) / 7;
+    if (pieces == 0)
+        return;
+
+    QByteArray framed(pieces * 8, 0);
+    for (unsigned i = 0; i < pieces; ++i) {
+        char * const piece = framed.data() + i * 8;
+        const unsigned size = qMin(7u, unsigned(payload.size()) - i * 7);
+        memcpy(piece, payload.constData() + i * 7, size);
+        piece[7] = -std::accumulate(piece, piece + 7, 0);
+    }
+
+    unsigned protocolErrors = 0;
+    unsigned deviceErrors = 0;
+    unsigned delay;
+    QTime timer;
+    timer.start();
+    const TimingConnection::CommandScope scope(this);
+    d->connection->purge();
+    for (unsigned i = 0; i < pieces;) {
+        const QByteArray piece(QByteArray::fromRawData
+                (framed.constData() + i * 8, 8));
+        try {
+            if (d->sendPiece(piece) != 0)
+                throw IgotuProtocolError(tr
+                        ("Non-empty intermediate response packet: %1")
+                        .arg(QString::fromAscii(piece.toHex())));
+            ++i;
+        } catch (const IgotuProtocolError &e) {
+            ++protocolErrors;
+            if (!d->retry(RetryPolicy::ProtocolError, protocolErrors,
+                        timer.elapsed(), &delay))
+                throw;
+            if (Messages::verbose() >= 1)
+                Messages::verboseMessage(tr("Protocol violated : %1")
+                        .arg(QString::fromLocal8Bit(e.what())));
+            d->waitForRetry(commandName(), RetryPolicy::ProtocolError, delay);
+            d->connection->purge();
+        } catch (const DeviceException &e) {
+            ++deviceErrors;
+            if (!d->retry(RetryPolicy::DeviceError, deviceErrors,
+                        timer.elapsed(), &delay))
+                throw;
+            if (Messages::verbose() >= 1)
+                Messages::verboseMessage(tr("Device error: %1")
+                        .arg(QString::fromLocal8Bit(e.what())));
+            d->waitForRetry(commandName(), RetryPolicy::DeviceError, delay);
+        }
+    }
+
+    if (Messages::verbose() >= 1)
+        Messages::verboseMessage(tr("Payload: %1")
+                .arg(QString::fromAscii(payload.toHex())));
+}
+
 } // namespace igotu
@@ -28,6 +28,7 @@ namespace igotu
 {
 
 class DataConnection;
+class RetryPolicy;
 
 class IgotuCommandPrivate;
 
@@ -52,8 +53,25 @@ public:
     bool ignoreProtocolErrors() const;
     void setIgnoreProtocolErrors(bool value);
 
+    // If set, response data of up to size bytes is received directly into
+    // buffer and sendAndReceive() returns a raw QByteArray that refers to it
+    void setResponseBuffer(char *buffer, unsigned size);
+
+    // defaults to RetryPolicy::currentPolicy() at construction
+    RetryPolicy retryPolicy() const;
+    void setRetryPolicy(const RetryPolicy &policy);
+
+    // used for retry and timing statistics
+    virtual QString commandName() const;
+
     virtual QByteArray sendAndReceive();
 
+protected:
+    // Sends the payload that follows an acknowledged command in pieces of 7
+    // bytes with a checksum each. The device acknowledges every piece, but
+    // the pieces are framed at once and only purged before the first one.
+    void sendPayload(const QByteArray &payload);
+
 private:
     boost::scoped_ptr<IgotuCommandPrivate> d;
 };
@@ -18,53 +18,165 @@
 
 #include "commands.h"
 #include "dataconnection.h"
+#include "downloadcache.h"
 #include "exception.h"
 #include "igotuconfig.h"
 #include "igotucontrol.h"
 #include "igotudata.h"
+#include "igotutask.h"
 #include "igotupoints.h"
+#include "latencyhistogram.h"
+#include "messages.h"
+#include "paths.h"
 #include "pluginloader.h"
+#include "progress.h"
+#include "retrypolicy.h"
+#include "timingconnection.h"
 #include "utils.h"
 
 #include <QDir>
+#include <QFile>
+#include <QFileInfo>
 #include <QLocale>
+#include <QMap>
 #include <QMutex>
 #include <QSemaphore>
 #include <QSet>
 #include <QStringList>
 #include <QThread>
 
+#include <cstring>
+
 namespace igotu
 {
 
+// Progress of the last download, so that it can be resumed after errors
+struct DownloadJournal
+{
+    DownloadJournal() :
+        serialNumber(0),
+        count(0),
+        completed(0)
+    {
+    }
+
+    unsigned serialNumber;
+    unsigned count;
+    // end of the part of data that has been downloaded without gaps
+    unsigned completed;
+    QByteArray data;
+};
+
+// Entry of the task queue, either a task or a notification
+struct QueuedTask
+{
+    QueuedTask() :
+        object(NULL)
+    {
+    }
+
+    // tasks that keep their position relative to all other entries
+    bool isBarrier() const
+    {
+        return !task.isValid() || task.type() == IgotuTask::Purge ||
+            task.type() == IgotuTask::Reset ||
+            task.type() == IgotuTask::Configure;
+    }
+
+    // interactive tasks run before queued downloads
+    bool isInteractive() const
+    {
+        return task.isValid() && task.type() == IgotuTask::Info;
+    }
+
+    IgotuTask task;
+    QVariantMap config;
+    // notification if the task is invalid
+    QObject *object;
+    QByteArray method;
+};
+
 class IgotuControlPrivateWorker : public QObject
 {
     Q_OBJECT
 public:
     IgotuControlPrivateWorker(IgotuControlPrivate *pub);
 
+    // Flash operations that are waited for with waitForWrite()
+    enum WriteOperation {
+        BlockErase,
+        PageProgram,
+        PurgeFinish,
+        WriteOperationCount
+    };
+
 public Q_SLOTS:
+    // Runs the next entry of the task queue
+    void processTask();
+    void disconnectQuietly();
+
+private:
     void infoCommand();
     void contentsCommand();
     void purgeCommand();
     void resetCommand();
     void configureCommand(const QVariantMap &config);
 
-    void notify(QObject *object, const QByteArray &method);
-    void disconnectQuietly();
+    void beginTask(const IgotuTask &task);
     void endTask();
 
-private:
+    // Emit the command signals and record them in the current task
+    void reportStarted(const QString &message);
+    void reportProgress(unsigned num, unsigned total);
+    void reportFailure(const QString &message);
+    // Emits contentsBlockRetrieved() for all blocks before end that have not
+    // been reported yet in the current download
+    void reportBlocks(const char *data, unsigned end);
+    // Starts a new phase of the transfer progress, total is in bytes
+    void startPhase(Progress::Phase phase, quint64 totalBytes = 0);
+    // Adds to the bytes transferred in this phase, emits progressChanged()
+    void addPhaseBytes(quint64 bytes);
+
     bool info(QString *infoText, QByteArray *configDump);
     bool contents(QByteArray *memoryDump, unsigned *blockCount);
     bool purge();
     bool reset();
-    bool write(const IgotuConfig &config);
+    // Erases the configuration block and writes the new configuration, does
+    // nothing if it equals the current configuration dump (if given)
+    bool write(const IgotuConfig &config,
+            const QByteArray &currentDump = QByteArray());
     bool configure(const QString &config);
 
     void connect();
+    // Opens the connection with the given id and switches off NMEA output,
+    // returns the serial number of the GPS tracker
+    unsigned connectTo(DataConnectionCreator *creator, const QString &id);
     void disconnect();
-    void waitForWrite();
+    // Identification and model of the connected GPS tracker, queried only
+    // once per connection
+    const IdentificationCommand &identification();
+    const ModelCommand &model();
+    // Polls until the flash is no longer busy, starting fast and backing off;
+    // throws after a deadline that depends on the model and the operation
+    void waitForWrite(WriteOperation operation);
+    // Upper limit for the busy time of a flash operation in ms
+    unsigned writeDeadline(WriteOperation operation) const;
+    // Reads flash memory from begin to end into data + begin, stops at the
+    // first erased record; progress is reported relative to blocks, the end
+    // of the data read so far is stored in completed
+    void readMemory(char *data, unsigned begin, unsigned end, unsigned blocks,
+            unsigned readKey, unsigned *completed);
+    // Reads a complete flash block, served from the block cache if possible
+    QByteArray readBlock(unsigned block);
+    // Remembers a flash block for the rest of the session; blocks that end
+    // with erased trackpoints are still being filled and not cached
+    void cacheBlock(unsigned block, const char *data);
+    // Checks that the journal still matches the memory of the GPS tracker
+    bool validateJournal();
+    // Probes the beginning of a flash block
+    bool blockErased(unsigned block);
+    // Number of trackpoints in the download cache that are still valid
+    unsigned validateCache(const DownloadCache &cache, unsigned count);
 
 Q_SIGNALS:
     void commandStarted(const QString &message);
@@ -74,13 +186,29 @@ Q_SIGNALS:
 
     void infoRetrieved(const QString &info, const QByteArray &contents);
     void contentsRetrieved(const QByteArray &contents, uint count);
+    void contentsBlockRetrieved(const QByteArray &block, uint offset);
+    void progressChanged(const igotu::Progress &progress);
+    void deviceConnected(const QString &device, uint serialNumber);
+
+    void taskStarted(const igotu::IgotuTask &task);
+    void taskFinished(const igotu::IgotuTask &task);
 
 private:
     IgotuControlPrivate * const p;
+    IgotuTask currentTask;
+    unsigned reportedBlocks;
+    Progress progress;
 
     boost::scoped_ptr<DataConnection> connection;
     QString connectedDevice;
+    unsigned connectedSerialNumber;
     QByteArray image;
+    DownloadJournal journal;
+    // reset together with the connection
+    boost::scoped_ptr<IdentificationCommand> identificationCache;
+    boost::scoped_ptr<ModelCommand> modelCache;
+    // Flash blocks read since the connection was opened, cleared on writes
+    QMap<unsigned, QByteArray> blockCache;
 };
 
 class IgotuControlPrivate : public QObject
@@ -90,42 +218,91 @@ class IgotuControlPrivate : public QObject
 public:
     IgotuControlPrivate();
 
-    // returns false if there are already too many tasks running
-    bool startTask();
+    // Queues the task, identical pending tasks are coalesced and the
+    // returned task can be a pending one; if there are already too many tasks
+    // queued, the returned task has failed
+    IgotuTask startTask(IgotuTask::Type type,
+            const QVariantMap &config = QVariantMap());
+    void queueNotification(QObject *object, const QByteArray &method);
+    // Removes the next entry from the queue: the first interactive task
+    // before any barrier, otherwise the first entry
+    QueuedTask takeTask();
+    // cancels the running task
     void requestCancel();
     bool cancelRequested() const;
 
     static QList<DataConnectionCreator*> creators();
 
-Q_SIGNALS:
-    void infoCommand();
-    void contentsCommand();
-    void purgeCommand();
-    void resetCommand();
-    void configureCommand(const QVariantMap &config);
+    // Largest read size that worked for a model/firmware combination,
+    // key is model << 16 | firmware; kept in the cache directory so that
+    // failing sizes are not probed again on every run
+    static unsigned readSize(unsigned key);
+    static void setReadSize(unsigned key, unsigned size);
+    // Expect readSizeLock to be held
+    static QString readSizeFileName();
+    static void loadReadSizes();
+    static void saveReadSizes();
+
+    // Measured busy times of flash operations per model name
+    static LatencyHistogram writeTime(const QString &model,
+            IgotuControlPrivateWorker::WriteOperation operation);
+    static void addWriteTime(const QString &model,
+            IgotuControlPrivateWorker::WriteOperation operation,
+            quint64 usecs);
 
-    void notify(QObject *object, const QByteArray &method);
+Q_SIGNALS:
+    // emitted once per queue entry
+    void processTask();
     void disconnectQuietly();
-    void endTask();
+
+    void taskFinished(const igotu::IgotuTask &task);
 
 public:
     unsigned taskCount;
     QSemaphore semaphore;
-    mutable QMutex cancelLock;
-    bool cancel;
+    // protects queue and runningTask
+    mutable QMutex queueLock;
+    QList<QueuedTask> queue;
+    IgotuTask runningTask;
     QThread thread;
     IgotuControlPrivateWorker worker;
     QString device;
     int utcOffset;
     bool tracksAsSegments;
+    bool largeReads;
+    bool downloadCache;
+    bool connectionStatistics;
+    unsigned serialNumber;
+    RetryPolicy retryPolicy;
+
+    static QMutex readSizeLock;
+    static QMap<unsigned, unsigned> readSizes;
+    static bool readSizesLoaded;
+
+    static QMutex writeTimeLock;
+    static QMap<QString, LatencyHistogram>
+        writeTimes[IgotuControlPrivateWorker::WriteOperationCount];
 };
 
 // Put translations in the right context
 //
 // TRANSLATOR igotu::IgotuControl
 
+// Read sizes to try, the response size is a signed 16 bit value
+static const unsigned largeReadSizes[] = { 0x7000, 0x4000, 0x2000, 0x1000 };
+
+// Longest delay between two polls of the flash status in ms
+static const unsigned maximumWritePollDelay = 50;
+
 // IgotuControlPrivate =========================================================
 
+QMutex IgotuControlPrivate::readSizeLock;
+QMap<unsigned, unsigned> IgotuControlPrivate::readSizes;
+bool IgotuControlPrivate::readSizesLoaded = false;
+QMutex IgotuControlPrivate::writeTimeLock;
+QMap<QString, LatencyHistogram> IgotuControlPrivate::writeTimes
+    [IgotuControlPrivateWorker::WriteOperationCount];
+
 IgotuControlPrivate::IgotuControlPrivate() :
     taskCount(10),
     semaphore(taskCount),
@@ -133,28 +310,103 @@ IgotuControlPrivate::IgotuControlPrivate() :
 {
 }
 
-bool IgotuControlPrivate::startTask()
+IgotuTask IgotuControlPrivate::startTask(IgotuTask::Type type,
+        const QVariantMap &config)
 {
-    if (!semaphore.tryAcquire())
-        return false;
+    QueuedTask entry;
+    entry.task = IgotuTask(type);
+    entry.config = config;
+
+    QMutexLocker locker(&queueLock);
+
+    int lastBarrier = queue.size() - 1;
+    while (lastBarrier >= 0 && !queue[lastBarrier].isBarrier())
+        --lastBarrier;
+
+    if (entry.isBarrier()) {
+        // Only a barrier at the end of the queue can be merged, tasks queued
+        // after it need to see the state it leaves behind
+        if (lastBarrier >= 0 && lastBarrier == queue.size() - 1 &&
+                queue[lastBarrier].task.isValid() &&
+                queue[lastBarrier].task.type() == type) {
+            QueuedTask &pending = queue[lastBarrier];
+            if (pending.config == config)
+                return pending.task;
+            // A newer configuration supersedes the pending one
+            IgotuTask superseded = pending.task;
+            pending = entry;
+            locker.unlock();
+            superseded.setMessage(IgotuControl::tr
+                    ("Superseded by a newer request"));
+            superseded.setState(IgotuTask::Cancelled);
+            emit taskFinished(superseded);
+            return entry.task;
+        }
+    } else {
+        // Only tasks after the last barrier are identical
+        for (int i = lastBarrier + 1; i < queue.size(); ++i)
+            if (queue[i].task.type() == type && queue[i].config == config)
+                return queue[i].task;
+    }
 
-    QMutexLocker locker(&cancelLock);
-    cancel = false;
-    return true;
+    if (!semaphore.tryAcquire()) {
+        entry.task.setMessage(IgotuControl::tr("Too many tasks queued"));
+        entry.task.setState(IgotuTask::Failed);
+        return entry.task;
+    }
+    queue.append(entry);
+    locker.unlock();
+
+    emit processTask();
+    return entry.task;
+}
+
+void IgotuControlPrivate::queueNotification(QObject *object,
+        const QByteArray &method)
+{
+    QueuedTask entry;
+    entry.object = object;
+    entry.method = method;
+
+    {
+        QMutexLocker locker(&queueLock);
+        queue.append(entry);
+    }
+
+    emit processTask();
+}
+
+QueuedTask IgotuControlPrivate::takeTask()
+{
+    QMutexLocker locker(&queueLock);
+
+    if (queue.isEmpty())
+        return QueuedTask();
+
+    int next = 0;
+    for (int i = 0; i < queue.size() && !queue[i].isBarrier(); ++i) {
+        if (queue[i].isInteractive()) {
+            next = i;
+            break;
+        }
+    }
+    const QueuedTask result = queue.takeAt(next);
+    runningTask = result.task;
+    return result;
 }
 
 bool IgotuControlPrivate::cancelRequested() const
 {
-    QMutexLocker locker(&cancelLock);
+    QMutexLocker locker(&queueLock);
 
-    return cancel;
+    return runningTask.isCancelRequested();
 }
 
 void IgotuControlPrivate::requestCancel()
 {
-    QMutexLocker locker(&cancelLock);
+    QMutexLocker locker(&queueLock);
 
-    cancel = true;
+    runningTask.cancel();
 }
 
 QList<DataConnectionCreator*> IgotuControlPrivate::creators()
@@ -170,16 +422,128 @@ QList<DataConnectionCreator*> IgotuControlPrivate::creators()
     return result;
 }
 
+unsigned IgotuControlPrivate::readSize(unsigned key)
+{
+    QMutexLocker locker(&readSizeLock);
+
+    loadReadSizes();
+    return readSizes.value(key, largeReadSizes[0]);
+}
+
+void IgotuControlPrivate::setReadSize(unsigned key, unsigned size)
+{
+    QMutexLocker locker(&readSizeLock);
+
+    loadReadSizes();
+    if (readSizes.value(key) == size)
+        return;
+    readSizes.insert(key, size);
+    saveReadSizes();
+}
+
+QString IgotuControlPrivate::readSizeFileName()
+{
+    return Paths::cacheDirectory() + QLatin1String("/readsizes");
+}
+
+void IgotuControlPrivate::loadReadSizes()
+{
+    if (readSizesLoaded)
+        return;
+    readSizesLoaded = true;
+
+    QFile file(readSizeFileName());
+    if (!file.open(QIODevice::ReadOnly))
+        return;
+
+    // One "key size" pair in hex per line
+    Q_FOREACH (const QByteArray &line, file.readAll().split('\n')) {
+        const QList<QByteArray> fields = line.simplified().split(' ');
+        if (fields.size() != 2)
+            continue;
+        bool keyOk, sizeOk;
+        const unsigned key = fields[0].toUInt(&keyOk, 16);
+        const unsigned size = fields[1].toUInt(&sizeOk, 16);
+        if (!keyOk || !sizeOk || size < largeReadSizes[3] ||
+                size > largeReadSizes[0]) {
+            Messages::verboseMessage(IgotuControl::tr
+                    ("Invalid read size entry in '%1'")
+                    .arg(file.fileName()));
+            continue;
+        }
+        readSizes.insert(key, size);
+    }
+}
+
+void IgotuControlPrivate::saveReadSizes()
+{
+    const QString name = readSizeFileName();
+    if (!QDir().mkpath(QFileInfo(name).path())) {
+        Messages::verboseMessage(IgotuControl::tr
+                ("Unable to create cache directory '%1'")
+                .arg(QFileInfo(name).path()));
+        return;
+    }
+
+    QByteArray contents;
+    for (QMap<unsigned, unsigned>::const_iterator i = readSizes.begin();
+            i != readSizes.end(); ++i)
+        contents += QByteArray::number(i.key(), 16) + ' ' +
+            QByteArray::number(i.value(), 16) + '\n';
+
+    // Other processes might read the file at the same time
+    QFile file(name + QLatin1String(".tmp"));
+    if (!file.open(QIODevice::WriteOnly) ||
+            file.write(contents) != contents.size() || !file.flush()) {
+        Messages::verboseMessage(IgotuControl::tr
+                ("Unable to write read sizes '%1': %2")
+                .arg(file.fileName(), file.errorString()));
+        file.remove();
+        return;
+    }
+    file.close();
+
+    QFile::remove(name);
+    if (!file.rename(name)) {
+        Messages::verboseMessage(IgotuControl::tr
+                ("Unable to write read sizes '%1': %2")
+                .arg(name, file.errorString()));
+        file.remove();
+    }
+}
+
+LatencyHistogram IgotuControlPrivate::writeTime(const QString &model,
+        IgotuControlPrivateWorker::WriteOperation operation)
+{
+    QMutexLocker locker(&writeTimeLock);
+
+    return writeTimes[operation].value(model);
+}
+
+void IgotuControlPrivate::addWriteTime(const QString &model,
+        IgotuControlPrivateWorker::WriteOperation operation, quint64 usecs)
+{
+    QMutexLocker locker(&writeTimeLock);
+
+    writeTimes[operation][model].add(usecs);
+}
+
 // IgotuControlPrivateWorker ===================================================
 
 IgotuControlPrivateWorker::IgotuControlPrivateWorker(IgotuControlPrivate *pub) :
-    p(pub)
+    p(pub),
+    reportedBlocks(0),
+    connectedSerialNumber(0)
 {
 }
 
 void IgotuControlPrivateWorker::connect()
 {
-    if (!connectedDevice.isEmpty() && p->device == connectedDevice)
+    // Commands are created in this thread
+    RetryPolicy::setCurrentPolicy(p->retryPolicy);
+
+    if (!connectedDevice.isEmpty() && p->device == connectedDevice &&
+            (p->serialNumber == 0 || p->serialNumber == connectedSerialNumber))
         return;
 
     disconnect();
@@ -191,26 +555,94 @@ void IgotuControlPrivateWorker::connect()
         image = QByteArray::fromBase64(name.toAscii());
         connectedDevice = p->device;
     } else {
+        DataConnectionCreator *selected = NULL;
         Q_FOREACH (DataConnectionCreator *creator, p->creators()) {
             if (creator->dataConnection() != protocol)
                 continue;
-            try {
-                connection.reset(creator->createDataConnection(name));
-                connectedDevice = p->device;
-                NmeaSwitchCommand(connection.get(), false).sendAndReceive();
-            } catch (...) {
-                connection.reset();
-                connectedDevice.clear();
-                throw;
-            }
+            selected = creator;
             break;
         }
-        if (!connection)
+        if (!selected)
             throw Exception(IgotuControl::tr("Unable to connect via '%1'")
                     .arg(p->device));
+
+        if (p->serialNumber == 0) {
+            connectedSerialNumber = connectTo(selected, name);
+            connectedDevice = p->device;
+            emit deviceConnected(p->device, connectedSerialNumber);
+            return;
+        }
+
+        // The given device might be a different GPS tracker, so all
+        // attached ones are tried after it
+        QStringList ids(name);
+        ids += selected->availableConnectionIds();
+        Q_FOREACH (const QString &id, ids) {
+            unsigned serialNumber;
+            try {
+                serialNumber = connectTo(selected, id);
+            } catch (const std::exception &e) {
+                Messages::verboseMessage(IgotuControl::tr
+                        ("Unable to connect to '%1': %2")
+                        .arg(protocol + QLatin1Char(':') + id)
+                        .arg(QString::fromLocal8Bit(e.what())));
+                continue;
+            }
+            if (serialNumber == p->serialNumber) {
+                connectedSerialNumber = serialNumber;
+                connectedDevice = p->device;
+                emit deviceConnected(protocol + QLatin1Char(':') + id,
+                        serialNumber);
+                return;
+            }
+            disconnectQuietly();
+        }
+        throw Exception(IgotuControl::tr
+                ("Unable to find GPS tracker with serial number %1")
+                .arg(p->serialNumber));
     }
 }
 
+unsigned IgotuControlPrivateWorker::connectTo(DataConnectionCreator *creator,
+        const QString &id)
+{
+    try {
+        connection.reset(creator->createDataConnection(id));
+        if (p->connectionStatistics)
+            connection.reset(new TimingConnection(connection.release()));
+        startPhase(Progress::Identify);
+        NmeaSwitchCommand(connection.get(), false).sendAndReceive();
+        return identification().serialNumber();
+    } catch (...) {
+        identificationCache.reset();
+        modelCache.reset();
+        connection.reset();
+        throw;
+    }
+}
+
+const IdentificationCommand &IgotuControlPrivateWorker::identification()
+{
+    if (!identificationCache) {
+        boost::scoped_ptr<IdentificationCommand> command
+            (new IdentificationCommand(connection.get()));
+        command->sendAndReceive();
+        identificationCache.swap(command);
+    }
+    return *identificationCache;
+}
+
+const ModelCommand &IgotuControlPrivateWorker::model()
+{
+    if (!modelCache) {
+        boost::scoped_ptr<ModelCommand> command
+            (new ModelCommand(connection.get()));
+        command->sendAndReceive();
+        modelCache.swap(command);
+    }
+    return *modelCache;
+}
+
 void IgotuControlPrivateWorker::disconnectQuietly()
 {
     try {
@@ -224,6 +656,9 @@ void IgotuControlPrivateWorker::disconnect()
 {
     image.clear();
     connectedDevice.clear();
+    identificationCache.reset();
+    modelCache.reset();
+    blockCache.clear();
     if (connection) {
         try {
             NmeaSwitchCommand(connection.get(), true).sendAndReceive();
@@ -236,58 +671,307 @@ void IgotuControlPrivateWorker::disconnect()
     }
 }
 
+void IgotuControlPrivateWorker::processTask()
+{
+    const QueuedTask entry = p->takeTask();
+    if (!entry.task.isValid()) {
+        if (entry.object)
+            QMetaObject::invokeMethod(entry.object, entry.method);
+        return;
+    }
+
+    beginTask(entry.task);
+    switch (entry.task.type()) {
+    case IgotuTask::Info:
+        infoCommand();
+        break;
+    case IgotuTask::Contents:
+        contentsCommand();
+        break;
+    case IgotuTask::Purge:
+        purgeCommand();
+        break;
+    case IgotuTask::Reset:
+        resetCommand();
+        break;
+    case IgotuTask::Configure:
+        configureCommand(entry.config);
+        break;
+    }
+    endTask();
+}
+
+void IgotuControlPrivateWorker::beginTask(const IgotuTask &task)
+{
+    currentTask = task;
+    currentTask.setState(IgotuTask::Running);
+    emit taskStarted(currentTask);
+}
+
 void IgotuControlPrivateWorker::endTask()
 {
+    if (currentTask.state() == IgotuTask::Running)
+        currentTask.setState(currentTask.isCancelRequested() ?
+                IgotuTask::Cancelled : IgotuTask::Succeeded);
+    {
+        QMutexLocker locker(&p->queueLock);
+        p->runningTask = IgotuTask();
+    }
+    emit taskFinished(currentTask);
+    currentTask = IgotuTask();
     p->semaphore.release();
 }
 
-void IgotuControlPrivateWorker::waitForWrite()
+void IgotuControlPrivateWorker::reportStarted(const QString &message)
+{
+    currentTask.setMessage(message);
+    emit commandStarted(message);
+}
+
+void IgotuControlPrivateWorker::reportProgress(unsigned num, unsigned total)
+{
+    currentTask.setProgress(num, total);
+    emit commandRunning(num, total);
+}
+
+void IgotuControlPrivateWorker::reportBlocks(const char *data, unsigned end)
+{
+    for (; (reportedBlocks + 1) * 0x1000 <= end; ++reportedBlocks)
+        emit contentsBlockRetrieved(QByteArray(data + reportedBlocks * 0x1000,
+                    0x1000), reportedBlocks * 0x1000);
+}
+
+void IgotuControlPrivateWorker::startPhase(Progress::Phase phase,
+        quint64 totalBytes)
+{
+    progress.start(phase, totalBytes, monotonicMicroseconds());
+    emit progressChanged(progress);
+}
+
+void IgotuControlPrivateWorker::addPhaseBytes(quint64 bytes)
+{
+    progress.update(progress.bytes() + bytes, monotonicMicroseconds());
+    emit progressChanged(progress);
+}
+
+void IgotuControlPrivateWorker::reportFailure(const QString &message)
 {
-    for (unsigned retries = 10; retries > 0; --retries) {
+    currentTask.setMessage(message);
+    currentTask.setState(currentTask.isCancelRequested() ?
+            IgotuTask::Cancelled : IgotuTask::Failed);
+    emit commandFailed(message);
+}
+
+void IgotuControlPrivateWorker::waitForWrite(WriteOperation operation)
+{
+    const QString modelName = model().modelName();
+    const LatencyHistogram previous = p->writeTime(modelName, operation);
+    // Measured busy times can only increase the deadline, never shorten it
+    // below the model default
+    const quint64 deadline = qMax(quint64(writeDeadline(operation)) * 1000,
+            4 * previous.maximum());
+    // Polling before half of the usual busy time has passed is pointless
+    unsigned delay = previous.count() > 0 ?
+        qMin(unsigned(previous.percentile(50) / 2000),
+                maximumWritePollDelay) : 0;
+
+    const quint64 start = monotonicMicroseconds();
+    unsigned polls = 0;
+    Q_FOREVER {
+        if (delay > 0)
+            sleepMicroseconds(delay * 1000);
+        ++polls;
         if (UnknownWriteCommand2(connection.get(), 0x0001)
                 .sendAndReceive() == QByteArray(1, '\x00'))
             break;
-        if (retries == 1)
+        if (monotonicMicroseconds() - start >= deadline)
             throw Exception(IgotuControl::tr("Command timeout"));
+        delay = qBound(1u, delay * 2, maximumWritePollDelay);
+    }
+
+    const quint64 elapsed = monotonicMicroseconds() - start;
+    p->addWriteTime(modelName, operation, elapsed);
+    if (Messages::verbose() >= 1)
+        Messages::verboseMessage(IgotuControl::tr
+                ("Flash busy for %1 ms, %2 polls")
+                .arg(elapsed / 1000.0, 0, 'f', 1).arg(polls));
+}
+
+unsigned IgotuControlPrivateWorker::writeDeadline(WriteOperation operation)
+    const
+{
+    // Conservative limits, the older GT-100 flash erases more slowly
+    const bool slowErase = modelCache &&
+        modelCache->modelId() == ModelCommand::Gt100;
+    switch (operation) {
+    case BlockErase:
+        return slowErase ? 3000 : 2000;
+    case PageProgram:
+        return 200;
+    case PurgeFinish:
+        return slowErase ? 6000 : 4000;
+    default:
+        return 2000;
+    }
+}
+
+void IgotuControlPrivateWorker::readMemory(char *data, unsigned begin,
+        unsigned total, unsigned blocks, unsigned readKey, unsigned *completed)
+{
+    unsigned readSize = p->largeReads ? p->readSize(readKey) : 0x1000;
+    for (unsigned pos = begin; pos < total;) {
+        reportProgress(pos / 0x1000, blocks);
+        if (p->cancelRequested())
+            throw Exception(IgotuControl::tr("Cancelled"));
+        if (pos % 0x1000 == 0 && total - pos >= 0x1000 &&
+                blockCache.contains(pos / 0x1000)) {
+            memcpy(data + pos, blockCache.value(pos / 0x1000).constData(),
+                    0x1000);
+            // Nothing transferred
+            progress.setTotalBytes(progress.totalBytes() - 0x1000);
+            pos += 0x1000;
+            *completed = pos;
+            reportBlocks(data, pos);
+            continue;
+        }
+        const unsigned size = qMin(readSize, total - pos);
+        if (size <= 0x1000) {
+            ReadCommand(connection.get(), pos, size, data + pos)
+                .sendAndReceive();
+        } else {
+            try {
+                // Throws on responses of the wrong length
+                ReadCommand(connection.get(), pos, size, data + pos)
+                    .sendAndReceive();
+            } catch (const IgotuProtocolError &e) {
+                // Fall back to the next smaller size for this firmware; other
+                // errors such as timeouts or a removed device are no reason
+                // to remember a smaller size and are passed on
+                unsigned i = 0;
+                while (largeReadSizes[i] >= readSize)
+                    ++i;
+                Messages::verboseMessage(IgotuControl::tr
+                        ("Reads of %1 bytes failed, trying %2 bytes: %3")
+                        .arg(readSize).arg(largeReadSizes[i])
+                        .arg(QString::fromLocal8Bit(e.what())));
+                readSize = largeReadSizes[i];
+                continue;
+            }
+            p->setReadSize(readKey, readSize);
+        }
+        for (unsigned block = (pos + 0xfff) / 0x1000;
+                (block + 1) * 0x1000 <= pos + size; ++block)
+            cacheBlock(block, data + block * 0x1000);
+        pos += size;
+        *completed = pos;
+        addPhaseBytes(size);
+        reportBlocks(data, pos);
+        // Erased trackpoint records, the rest of the memory is unused
+        if (pos > 0x1000 && pos < total &&
+                QByteArray::fromRawData(data + pos - 0x20, 0x20) ==
+                QByteArray(0x20, '\xff')) {
+            Messages::verboseMessage(IgotuControl::tr
+                    ("Erased trackpoints at 0x%1, stopping download")
+                    .arg(pos - 0x20, 0, 16));
+            break;
+        }
     }
 }
 
+QByteArray IgotuControlPrivateWorker::readBlock(unsigned block)
+{
+    if (blockCache.contains(block))
+        return blockCache.value(block);
+
+    const QByteArray result = ReadCommand(connection.get(), block * 0x1000,
+            0x1000).sendAndReceive();
+    if (result.size() == 0x1000)
+        cacheBlock(block, result.constData());
+    return result;
+}
+
+void IgotuControlPrivateWorker::cacheBlock(unsigned block, const char *data)
+{
+    if (block > 0 && QByteArray::fromRawData(data + 0x1000 - 0x20, 0x20) ==
+            QByteArray(0x20, '\xff'))
+        return;
+    blockCache.insert(block, QByteArray(data, 0x1000));
+}
+
+unsigned IgotuControlPrivateWorker::validateCache(const DownloadCache &cache,
+        unsigned count)
+{
+    // Fewer trackpoints than cached means the memory has been cleared
+    if (cache.count() == 0 || cache.count() > count)
+        return 0;
+
+    // The first and last cached blocks must still be the same
+    const QByteArray contents = cache.contents();
+    QList<unsigned> probes;
+    probes << 1 << cache.blocks() - 1;
+    Q_FOREACH (unsigned block, probes) {
+        if (ReadCommand(connection.get(), block * 0x1000, 0x10)
+                .sendAndReceive() != contents.mid(block * 0x1000, 0x10))
+            return 0;
+    }
+    return cache.count();
+}
+
+bool IgotuControlPrivateWorker::blockErased(unsigned block)
+{
+    return ReadCommand(connection.get(), block * 0x1000, 0x10)
+        .sendAndReceive() == QByteArray(0x10, '\xff');
+}
+
+bool IgotuControlPrivateWorker::validateJournal()
+{
+    if (journal.completed == 0)
+        return true;
+
+    // The last block that has been read must still be the same
+    const unsigned pos = (journal.completed - 1) & ~0xfffu;
+    return ReadCommand(connection.get(), pos, 0x10).sendAndReceive() ==
+        journal.data.mid(pos, 0x10);
+}
+
 bool IgotuControlPrivateWorker::info(QString *infoText, QByteArray *configDump)
 {
     if (p->cancelRequested())
         return false;
 
-    emit commandStarted(tr("Downloading configuration..."));
+    reportStarted(tr("Downloading configuration..."));
     try {
         connect();
 
         QByteArray contents;
         QString status;
         if (connection) {
-            IdentificationCommand id(connection.get());
-            id.sendAndReceive();
+            const IdentificationCommand &id = identification();
             status += IgotuControl::tr("Serial number: %1").arg(id.serialNumber()) +
                 QLatin1Char('\n');
             status += IgotuControl::tr("Firmware version: %1")
                 .arg(id.firmwareVersionString()) + QLatin1Char('\n');
 
-            ModelCommand model(connection.get());
-            model.sendAndReceive();
-            if (model.modelId() != ModelCommand::Unknown)
-                status += IgotuControl::tr("Model: %1").arg(model.modelName()) +
-                    QLatin1Char('\n');
+            const ModelCommand &modelCommand = model();
+            if (modelCommand.modelId() != ModelCommand::Unknown)
+                status += IgotuControl::tr("Model: %1")
+                    .arg(modelCommand.modelName()) + QLatin1Char('\n');
             else
                 status += IgotuControl::tr("Model: %1, please file a bug at "
                         "http://bugs.launchpad.net/igotu2gpx/+filebug")
-                    .arg(model.modelName()) + QLatin1Char('\n');
+                    .arg(modelCommand.modelName()) + QLatin1Char('\n');
 
+            startPhase(Progress::Count);
             CountCommand countCommand(connection.get());
             countCommand.sendAndReceive();
             unsigned count = countCommand.trackPointCount();
             status += IgotuControl::tr("Number of points: %1")
                 .arg(count) + QLatin1Char('\n');
-            contents = ReadCommand(connection.get(), 0, 0x1000)
-                .sendAndReceive();
+            const bool cached = blockCache.contains(0);
+            startPhase(Progress::Read, cached ? 0 : 0x1000);
+            contents = readBlock(0);
+            if (!cached)
+                addPhaseBytes(contents.size());
         } else {
             contents = image.left(0x1000);
         }
@@ -402,7 +1086,7 @@ bool IgotuControlPrivateWorker::info(QString *infoText, QByteArray *configDump)
         return true;
     } catch (const std::exception &e) {
         disconnectQuietly();
-        emit commandFailed(tr
+        reportFailure(tr
                 ("Unable to download configuration from GPS tracker: %1")
                 .arg(QString::fromLocal8Bit(e.what())));
         return false;
@@ -414,34 +1098,88 @@ bool IgotuControlPrivateWorker::contents(QByteArray *memoryDump, unsigned *block
     if (p->cancelRequested())
         return false;
 
-    emit commandStarted(tr("Downloading tracks..."));
+    reportStarted(tr("Downloading tracks..."));
+    reportedBlocks = 0;
     try {
         connect();
 
         QByteArray data;
         unsigned count;
         if (connection) {
-            IdentificationCommand id(connection.get());
-            id.sendAndReceive();
+            const IdentificationCommand &id = identification();
 
+            startPhase(Progress::Count);
             CountCommand countCommand(connection.get());
             countCommand.sendAndReceive();
             count = countCommand.trackPointCount();
             const unsigned blocks = 1 + (count + 0x7f) / 0x80;
 
-            for (unsigned i = 0; i < blocks; ++i) {
-                emit commandRunning(i, blocks);
-                if (p->cancelRequested())
-                    throw Exception(IgotuControl::tr("Cancelled"));
-                data += ReadCommand(connection.get(), i * 0x1000,
-                        0x1000).sendAndReceive();
+            unsigned readKey = id.firmwareVersion();
+            if (p->largeReads)
+                readKey |= model().modelId() << 16;
+
+            // Resume an interrupted download of the same data
+            if (journal.serialNumber == id.serialNumber() &&
+                    journal.count == count && validateJournal()) {
+                Messages::verboseMessage(IgotuControl::tr
+                        ("Resuming download at 0x%1")
+                        .arg(journal.completed, 0, 16));
+            } else {
+                journal.serialNumber = id.serialNumber();
+                journal.count = count;
+                journal.completed = 0;
+                // Only the used part is read, the rest of the last block is
+                // left erased
+                journal.data = QByteArray(blocks * 0x1000, '\xff');
             }
-            emit commandRunning(blocks, blocks);
+
+            startPhase(Progress::Read, 0x1000 + count * 0x20 -
+                    qMin(journal.completed, 0x1000 + count * 0x20));
+            readMemory(journal.data.data(), journal.completed, 0x1000, blocks,
+                    readKey, &journal.completed);
+            reportBlocks(journal.data.constData(), journal.completed);
+
+            // Complete trackpoint blocks from the last download can be reused,
+            // the configuration block is always read again
+            boost::scoped_ptr<DownloadCache> cache;
+            if (p->downloadCache) {
+                cache.reset(new DownloadCache(id.serialNumber()));
+                unsigned cached = 0;
+                if (cache->load())
+                    cached = validateCache(*cache, count);
+                if (0x1000 + cached * 0x20 > journal.completed) {
+                    Messages::verboseMessage(IgotuControl::tr
+                            ("Using %1 cached trackpoints from '%2'")
+                            .arg(cached).arg(cache->fileName()));
+                    journal.data.replace(journal.completed,
+                            0x1000 + cached * 0x20 - journal.completed,
+                            cache->contents().mid(journal.completed,
+                                0x1000 + cached * 0x20 - journal.completed));
+                    progress.setTotalBytes(progress.totalBytes() -
+                            (0x1000 + cached * 0x20 - journal.completed));
+                    journal.completed = 0x1000 + cached * 0x20;
+                    reportBlocks(journal.data.constData(), journal.completed);
+                }
+            }
+
+            readMemory(journal.data.data(), journal.completed,
+                    0x1000 + count * 0x20, blocks, readKey,
+                    &journal.completed);
+            // The rest of the last block is erased
+            reportBlocks(journal.data.constData(), journal.data.size());
+            reportProgress(blocks, blocks);
+
+            data = journal.data;
+            journal = DownloadJournal();
+
+            if (cache)
+                cache->save(data, count);
         } else {
             data = image;
             if (data.size() < 0x1000)
                 throw Exception(IgotuControl::tr("Invalid data"));
             count = (data.size() - 0x1000) / 0x20;
+            reportBlocks(data.constData(), data.size());
         }
 
         emit commandSucceeded();
@@ -452,7 +1190,7 @@ bool IgotuControlPrivateWorker::contents(QByteArray *memoryDump, unsigned *block
         return true;
     } catch (const std::exception &e) {
         disconnectQuietly();
-        emit commandFailed(tr
+        reportFailure(tr
                 ("Unable to download trackpoints from GPS tracker: %1")
                 .arg(QString::fromLocal8Bit(e.what())));
         return false;
@@ -464,22 +1202,20 @@ bool IgotuControlPrivateWorker::purge()
     if (p->cancelRequested())
         return false;
 
-    emit commandStarted(tr("Clearing memory..."));
+    reportStarted(tr("Clearing memory..."));
+    journal = DownloadJournal();
     try {
         connect();
 
         if (!connection)
             throw Exception(IgotuControl::tr("No device specified"));
 
-        IdentificationCommand id(connection.get());
-        id.sendAndReceive();
-
-        ModelCommand model(connection.get());
-        model.sendAndReceive();
+        const IdentificationCommand &id = identification();
+        blockCache.clear();
 
         unsigned blocks = 1;
 
-        switch (model.modelId()) {
+        switch (model().modelId()) {
         case ModelCommand::Gt100:
             blocks = 0x080;
             break;
@@ -494,119 +1230,135 @@ bool IgotuControlPrivateWorker::purge()
                     ("%1: Unable to clear memory of this GPS tracker model. "
                      "Instructions how to help with this can be found at "
                      "https://answers.launchpad.net/igotu2gpx/+faq/480.")
-                    .arg(model.modelName()));
+                    .arg(model().modelName()));
         }
 
-        if (id.firmwareVersion() >= 0x0215) {
-            bool purgeBlocks = false;
-            for (unsigned i = blocks - 1; i > 0; --i) {
-                emit commandRunning(blocks - i - 1, blocks);
-                if (p->cancelRequested())
-                    throw Exception(IgotuControl::tr("Cancelled"));
-                if (purgeBlocks) {
-                    waitForWrite();
-                } else {
-                    if (ReadCommand(connection.get(), i * 0x1000, 0x10)
-                            .sendAndReceive() != QByteArray(0x10, '\xff'))
-                        purgeBlocks = true;
-                    else
-                        continue;
-                }
-                UnknownWriteCommand1(connection.get(), 0x00).sendAndReceive();
-                WriteCommand(connection.get(), 0x20, i * 0x1000, QByteArray())
-                    .sendAndReceive();
+        // Trackpoints are written in order, so the count determines the last
+        // used block; only the block after it is probed in case the count
+        // does not match the memory, e.g. after an interrupted purge
+        startPhase(Progress::Count);
+        CountCommand countCommand(connection.get());
+        countCommand.sendAndReceive();
+        unsigned lastBlock = qMin(blocks - 1,
+                (countCommand.trackPointCount() + 0x7f) / 0x80);
+        if (lastBlock + 1 < blocks && !blockErased(lastBlock + 1)) {
+            Messages::verboseMessage(IgotuControl::tr
+                    ("Trackpoints after block %1, searching for the last "
+                     "used block").arg(lastBlock));
+            lastBlock = blocks - 1;
+            while (lastBlock > 0 && blockErased(lastBlock))
+                --lastBlock;
+        }
+
+        startPhase(Progress::Erase, lastBlock * 0x1000);
+        for (unsigned i = lastBlock; i > 0; --i) {
+            reportProgress(lastBlock - i, lastBlock + 1);
+            if (p->cancelRequested())
+                throw Exception(IgotuControl::tr("Cancelled"));
+            if (i != lastBlock) {
+                waitForWrite(BlockErase);
+                addPhaseBytes(0x1000);
             }
-            if (purgeBlocks) {
+            UnknownWriteCommand1(connection.get(), 0x00).sendAndReceive();
+            WriteCommand(connection.get(), 0x20, i * 0x1000, QByteArray())
+                .sendAndReceive();
+        }
+        if (id.firmwareVersion() >= 0x0215) {
+            if (lastBlock > 0) {
                 UnknownPurgeCommand1(connection.get(), 0x1e).sendAndReceive();
                 UnknownPurgeCommand1(connection.get(), 0x1f).sendAndReceive();
-                waitForWrite();
+                waitForWrite(PurgeFinish);
+                addPhaseBytes(0x1000);
             }
             UnknownPurgeCommand1(connection.get(), 0x1e).sendAndReceive();
             UnknownPurgeCommand1(connection.get(), 0x1f).sendAndReceive();
-            emit commandRunning(blocks, blocks);
         } else {
-            bool purgeBlocks = false;
-            for (unsigned i = blocks - 1; i > 0; --i) {
-                emit commandRunning(blocks - i - 1, blocks);
-                if (p->cancelRequested())
-                    throw Exception(IgotuControl::tr("Cancelled"));
-                if (purgeBlocks) {
-                    waitForWrite();
-                } else {
-                    if (ReadCommand(connection.get(), i * 0x1000, 0x10)
-                            .sendAndReceive() != QByteArray(0x10, '\xff'))
-                        purgeBlocks = true;
-                    else
-                        continue;
-                }
-                UnknownWriteCommand1(connection.get(), 0x00).sendAndReceive();
-                WriteCommand(connection.get(), 0x20, i * 0x1000, QByteArray())
-                    .sendAndReceive();
-            }
-            if (purgeBlocks) {
+            if (lastBlock > 0) {
                 UnknownPurgeCommand2(connection.get()).sendAndReceive();
-                waitForWrite();
+                waitForWrite(PurgeFinish);
+                addPhaseBytes(0x1000);
             }
             UnknownPurgeCommand2(connection.get()).sendAndReceive();
-            emit commandRunning(blocks, blocks);
         }
+        reportProgress(lastBlock + 1, lastBlock + 1);
 
         emit commandSucceeded();
         return true;
     } catch (const std::exception &e) {
         disconnectQuietly();
-        emit commandFailed(tr
+        reportFailure(tr
             ("Unable to clear memory of GPS tracker: %1")
             .arg(QString::fromLocal8Bit(e.what())));
         return false;
     }
 }
 
-bool IgotuControlPrivateWorker::write(const IgotuConfig &config)
+bool IgotuControlPrivateWorker::write(const IgotuConfig &config,
+        const QByteArray &currentDump)
 {
     if (p->cancelRequested())
         return false;
 
-    emit commandStarted(tr("Writing configuration..."));
+    const QByteArray configData = config.memoryDump();
+    if (!currentDump.isEmpty() && configData == currentDump) {
+        Messages::verboseMessage(IgotuControl::tr
+                ("Configuration unchanged, not writing"));
+        return true;
+    }
+
+    reportStarted(tr("Writing configuration..."));
+    journal = DownloadJournal();
     try {
         connect();
 
         if (connection) {
-            IdentificationCommand id(connection.get());
-            id.sendAndReceive();
-
-            ModelCommand model(connection.get());
-            model.sendAndReceive();
+            // Makes sure the model is known for waitForWrite()
+            model();
+            blockCache.clear();
 
+            startPhase(Progress::Erase, 0x1000);
             UnknownWriteCommand1(connection.get(), 0x00).sendAndReceive();
             WriteCommand(connection.get(), 0x20, 0x0000, QByteArray())
                 .sendAndReceive();
-            waitForWrite();
-
-            unsigned blocks = 0x10;
-            QByteArray configData = config.memoryDump();
-            for (unsigned i = 0; i < blocks; ++i) {
-                emit commandRunning(i, blocks + 1);
+            waitForWrite(BlockErase);
+            addPhaseBytes(0x1000);
+
+            // The erase leaves all bytes at 0xff, such pages need no write
+            const QByteArray erasedPage(0x100, '\xff');
+            QList<unsigned> pages;
+            for (unsigned i = 0; i < 0x10; ++i)
+                if (configData.mid(i * 0x0100, 0x100) != erasedPage)
+                    pages.append(i);
+            Messages::verboseMessage(IgotuControl::tr
+                    ("Writing %1 of %2 configuration pages")
+                    .arg(pages.count()).arg(0x10));
+
+            const unsigned steps = pages.count();
+            startPhase(Progress::Program, steps * 0x100);
+            for (unsigned i = 0; i < steps; ++i) {
+                reportProgress(i, steps + 1);
                 if (p->cancelRequested())
                     throw Exception(IgotuControl::tr("Cancelled"));
+                const unsigned page = pages[i];
                 UnknownWriteCommand1(connection.get(), 0x00).sendAndReceive();
-                WriteCommand(connection.get(), 0x02, i * 0x0100,
-                        configData.mid(i * 0x0100, 0x100)).sendAndReceive();
-                waitForWrite();
+                WriteCommand(connection.get(), 0x02, page * 0x0100,
+                        configData.mid(page * 0x0100, 0x100)).sendAndReceive();
+                waitForWrite(PageProgram);
+                addPhaseBytes(0x100);
             }
-            emit commandRunning(blocks, blocks + 1);
+            reportProgress(steps, steps + 1);
             TimeCommand(connection.get(), QDateTime::currentDateTime()
                     .toUTC().time()).sendAndReceive();
             ReadCommand(connection.get(), 0, 0x1000).sendAndReceive();
             UnknownWriteCommand3(connection.get()).sendAndReceive();
-            emit commandRunning(blocks + 1, blocks + 1);
+            reportProgress(steps + 1, steps + 1);
         }
 
         emit commandSucceeded();
         return true;
     } catch (const std::exception &e) {
         disconnectQuietly();
-        emit commandFailed(tr
+        reportFailure(tr
             ("Unable to write configuration to GPS tracker: %1")
             .arg(QString::fromLocal8Bit(e.what())));
         return false;
@@ -628,6 +1380,7 @@ void IgotuControlPrivateWorker::infoCommand()
     if (!info(&infoText, &configDump))
         return;
 
+    currentTask.setInfo(infoText, configDump);
     emit infoRetrieved(infoText, configDump);
 }
 
@@ -639,6 +1392,7 @@ void IgotuControlPrivateWorker::contentsCommand()
     if (!contents(&memoryDump, &blockCount))
         return;
 
+    currentTask.setContents(memoryDump, blockCount);
     emit contentsRetrieved(memoryDump, blockCount);
 }
 
@@ -693,21 +1447,16 @@ void IgotuControlPrivateWorker::configureCommand(const QVariantMap &config)
         }
     }
 
-    if (!write(igotuConfig.memoryDump()))
+    if (!write(igotuConfig, configDump))
         return;
 
     if (!info(&infoText, &configDump))
         return;
 
+    currentTask.setInfo(infoText, configDump);
     emit infoRetrieved(infoText, configDump);
 }
 
-void IgotuControlPrivateWorker::notify(QObject *object,
-        const QByteArray &method)
-{
-    QMetaObject::invokeMethod(object, method);
-}
-
 // IgotuControl ================================================================
 
 IgotuControl::IgotuControl(QObject *parent) :
@@ -715,12 +1464,24 @@ IgotuControl::IgotuControl(QObject *parent) :
     d(new IgotuControlPrivate)
 {
     qRegisterMetaType<IgotuConfig>("IgotuConfig");
+    qRegisterMetaType<IgotuTask>("IgotuTask");
+    qRegisterMetaType<IgotuTask>("igotu::IgotuTask");
+    qRegisterMetaType<Progress>("Progress");
+    qRegisterMetaType<Progress>("igotu::Progress");
 
     setDevice(defaultDevice());
     setUtcOffset(defaultUtcOffset());
     setTracksAsSegments(defaultTracksAsSegments());
+    setLargeReads(defaultLargeReads());
+    setDownloadCache(defaultDownloadCache());
+    setConnectionStatistics(defaultConnectionStatistics());
+    setSerialNumber(defaultSerialNumber());
+    setRetryPolicy(defaultRetryPolicy());
 
     connectWorker(&d->worker, this, d.get());
+    // superseded tasks finish without reaching the worker
+    connect(d.get(), SIGNAL(taskFinished(igotu::IgotuTask)),
+            this, SIGNAL(taskFinished(igotu::IgotuTask)));
     d->worker.moveToThread(&d->thread);
     d->thread.start();
 }
@@ -755,6 +1516,16 @@ QString IgotuControl::defaultDevice()
         creator->defaultConnectionId();
 }
 
+QStringList IgotuControl::availableDevices()
+{
+    QStringList result;
+    Q_FOREACH (DataConnectionCreator * const creator,
+            IgotuControlPrivate::creators())
+        Q_FOREACH (const QString &id, creator->availableConnectionIds())
+            result.append(creator->dataConnection() + QLatin1Char(':') + id);
+    return result;
+}
+
 void IgotuControl::setUtcOffset(int utcOffset)
 {
     d->utcOffset = utcOffset;
@@ -775,6 +1546,66 @@ bool IgotuControl::tracksAsSegments() const
     return d->tracksAsSegments;
 }
 
+void IgotuControl::setLargeReads(bool largeReads)
+{
+    d->largeReads = largeReads;
+}
+
+bool IgotuControl::largeReads() const
+{
+    return d->largeReads;
+}
+
+void IgotuControl::setDownloadCache(bool downloadCache)
+{
+    d->downloadCache = downloadCache;
+}
+
+bool IgotuControl::downloadCache() const
+{
+    return d->downloadCache;
+}
+
+void IgotuControl::setConnectionStatistics(bool connectionStatistics)
+{
+    d->connectionStatistics = connectionStatistics;
+}
+
+bool IgotuControl::connectionStatistics() const
+{
+    return d->connectionStatistics;
+}
+
+void IgotuControl::setSerialNumber(uint serialNumber)
+{
+    d->serialNumber = serialNumber;
+}
+
+unsigned IgotuControl::serialNumber() const
+{
+    return d->serialNumber;
+}
+
+void IgotuControl::setRetryPolicy(const RetryPolicy &policy)
+{
+    d->retryPolicy = policy;
+}
+
+RetryPolicy IgotuControl::retryPolicy() const
+{
+    return d->retryPolicy;
+}
+
+void IgotuControl::copySettings(const IgotuControl *control)
+{
+    setUtcOffset(control->utcOffset());
+    setTracksAsSegments(control->tracksAsSegments());
+    setLargeReads(control->largeReads());
+    setDownloadCache(control->downloadCache());
+    setConnectionStatistics(control->connectionStatistics());
+    setRetryPolicy(control->retryPolicy());
+}
+
 int IgotuControl::defaultUtcOffset()
 {
     return 0;
@@ -785,6 +1616,31 @@ bool IgotuControl::defaultTracksAsSegments()
     return false;
 }
 
+bool IgotuControl::defaultLargeReads()
+{
+    return false;
+}
+
+bool IgotuControl::defaultDownloadCache()
+{
+    return false;
+}
+
+bool IgotuControl::defaultConnectionStatistics()
+{
+    return false;
+}
+
+unsigned IgotuControl::defaultSerialNumber()
+{
+    return 0;
+}
+
+RetryPolicy IgotuControl::defaultRetryPolicy()
+{
+    return RetryPolicy();
+}
+
 bool IgotuControl::queuesEmpty()
 {
     if (!d->semaphore.tryAcquire(d->taskCount))
@@ -793,49 +1649,34 @@ bool IgotuControl::queuesEmpty()
     return true;
 }
 
-void IgotuControl::info()
+IgotuTask IgotuControl::info()
 {
-    if (!d->startTask())
-        return;
-    emit d->infoCommand();
-    emit d->endTask();
+    return d->startTask(IgotuTask::Info);
 }
 
-void IgotuControl::contents()
+IgotuTask IgotuControl::contents()
 {
-    if (!d->startTask())
-        return;
-    emit d->contentsCommand();
-    emit d->endTask();
+    return d->startTask(IgotuTask::Contents);
 }
 
-void IgotuControl::purge()
+IgotuTask IgotuControl::purge()
 {
-    if (!d->startTask())
-        return;
-    emit d->purgeCommand();
-    emit d->endTask();
+    return d->startTask(IgotuTask::Purge);
 }
 
-void IgotuControl::reset()
+IgotuTask IgotuControl::reset()
 {
-    if (!d->startTask())
-        return;
-    emit d->resetCommand();
-    emit d->endTask();
+    return d->startTask(IgotuTask::Reset);
 }
 
-void IgotuControl::configure(const QVariantMap &config)
+IgotuTask IgotuControl::configure(const QVariantMap &config)
 {
-    if (!d->startTask())
-        return;
-    emit d->configureCommand(config);
-    emit d->endTask();
+    return d->startTask(IgotuTask::Configure, config);
 }
 
 void IgotuControl::notify(QObject *object, const char *method)
 {
-    emit d->notify(object, method);
+    d->queueNotification(object, method);
 }
 
 void IgotuControl::cancel()
@@ -855,6 +1696,30 @@ QList<QPair<const char*, QString> > IgotuControl::configureParameters()
     return result;
 }
 
+QStringList IgotuControl::writeStatistics()
+{
+    const QString operationNames
+        [IgotuControlPrivateWorker::WriteOperationCount] = {
+        tr("block erase"), tr("page program"), tr("purge")
+    };
+
+    QStringList result;
+    QMutexLocker locker(&IgotuControlPrivate::writeTimeLock);
+    for (unsigned i = 0; i < IgotuControlPrivateWorker::WriteOperationCount;
+            ++i) {
+        const QMap<QString, LatencyHistogram> &times =
+            IgotuControlPrivate::writeTimes[i];
+        for (QMap<QString, LatencyHistogram>::const_iterator j =
+                times.begin(); j != times.end(); ++j)
+            result.append(tr("%1 %2: %3 writes, p50 %4 ms, max %5 ms")
+                    .arg(j.key(), operationNames[i])
+                    .arg(j.value().count())
+                    .arg(j.value().percentile(50) / 1000.0, 0, 'f', 1)
+                    .arg(j.value().maximum() / 1000.0, 0, 'f', 1));
+    }
+    return result;
+}
+
 } // namespace igotu
 
 #include "igotucontrol.moc"
@@ -20,11 +20,14 @@
 #define _IGOTU2GPX_SRC_IGOTU_IGOTUCONTROL_H_
 
 #include "global.h"
+#include "igotutask.h"
+#include "progress.h"
 
 #include <boost/scoped_ptr.hpp>
 
 #include <QObject>
 #include <QPair>
+#include <QStringList>
 #include <QVariantMap>
 
 namespace igotu
@@ -32,6 +35,7 @@ namespace igotu
 
 class IgotuControlPrivate;
 class IgotuConfig;
+class RetryPolicy;
 
 class IGOTU_EXPORT IgotuControl : public QObject
 {
@@ -44,6 +48,8 @@ public:
     QString device() const;
     // default device for the platform
     static QString defaultDevice();
+    // all attached GPS trackers that can be addressed individually
+    static QStringList availableDevices();
 
     int utcOffset() const;
     static int defaultUtcOffset();
@@ -51,19 +57,57 @@ public:
     bool tracksAsSegments() const;
     static bool defaultTracksAsSegments();
 
-    void info();
-    void contents();
-    void purge();
-    void reset();
-    void configure(const QVariantMap &config);
+    // download trackpoints with reads larger than one block if the GPS
+    // tracker supports it
+    bool largeReads() const;
+    static bool defaultLargeReads();
+
+    // reuse trackpoints of the last download that are still on the GPS
+    // tracker, see DownloadCache
+    bool downloadCache() const;
+    static bool defaultDownloadCache();
+
+    // record the durations of all data connection calls for new connections,
+    // see TimingConnection
+    bool connectionStatistics() const;
+    static bool defaultConnectionStatistics();
+
+    // only connect to the GPS tracker with this serial number, 0 for any;
+    // if the device is a different GPS tracker, all attached ones of the same
+    // connection type are tried
+    unsigned serialNumber() const;
+    static unsigned defaultSerialNumber();
+
+    // used for all commands sent to the GPS tracker
+    RetryPolicy retryPolicy() const;
+    void setRetryPolicy(const RetryPolicy &policy);
+    static RetryPolicy defaultRetryPolicy();
+
+    // copies all settings except device and serial number
+    void copySettings(const IgotuControl *control);
+
+    // tasks are processed by a worker thread, the returned handle can be
+    // used to follow and cancel each of them; info runs before queued
+    // downloads, purge, reset, configure and notify keep their order
+    // relative to all other tasks; a request identical to a pending one
+    // returns the pending task, a new configuration supersedes a pending one
+    IgotuTask info();
+    IgotuTask contents();
+    IgotuTask purge();
+    IgotuTask reset();
+    IgotuTask configure(const QVariantMap &config);
 
     static QList<QPair<const char*, QString> > configureParameters();
 
+    // measured busy times of flash erase and program operations per model,
+    // one line per model and operation
+    static QStringList writeStatistics();
+
     // schedules a slot of an object that will be called when all tasks have
     // been processed
     void notify(QObject *object, const char *method);
 
-    // signals the thread to cancel the currently running operation
+    // cancels the currently running task, queued tasks are not affected
     void cancel();
 
     // Returns true if no tasks are pending
@@ -73,6 +117,10 @@ public Q_SLOTS:
     void setDevice(const QString &device);
     void setUtcOffset(int seconds);
     void setTracksAsSegments(bool tracksAsSegments);
+    void setLargeReads(bool largeReads);
+    void setDownloadCache(bool downloadCache);
+    void setConnectionStatistics(bool connectionStatistics);
+    void setSerialNumber(uint serialNumber);
 
 Q_SIGNALS:
     void commandStarted(const QString &message);
@@ -83,6 +131,20 @@ Q_SIGNALS:
 
     void infoRetrieved(const QString &info, const QByteArray &contents);
     void contentsRetrieved(const QByteArray &contents, uint count);
+    // emitted for each 4 KiB block of the flash memory during contents(),
+    // in order and before contentsRetrieved(); offset is the position of the
+    // block in the memory dump, offset 0 starts a new download
+    void contentsBlockRetrieved(const QByteArray &block, uint offset);
+    // transferred bytes, rates and remaining time of the current phase of a
+    // command, emitted at the start of a phase and after each transfer
+    void progressChanged(const igotu::Progress &progress);
+    // emitted for every new connection, device addresses the GPS tracker
+    void deviceConnected(const QString &device, uint serialNumber);
+
+    // the command signals above between these two refer to the task;
+    // qualified so that the signatures also work outside of the namespace
+    void taskStarted(const igotu::IgotuTask &task);
+    void taskFinished(const igotu::IgotuTask &task);
 
 protected:
     boost::scoped_ptr<IgotuControlPrivate> d;
@@ -186,6 +186,11 @@ QByteArray IgotuPoint::hex() const
 
 // IgotuPoints =================================================================
 
+IgotuPoints::IgotuPoints() :
+    count(0)
+{
+}
+
 IgotuPoints::IgotuPoints(const QByteArray &dump, unsigned count) :
     dump(dump),
     count(count)
@@ -200,6 +205,22 @@ IgotuPoints::~IgotuPoints()
 {
 }
 
+void IgotuPoints::append(const QByteArray &records)
+{
+    // The dump only extends beyond count after an erased record
+    if (unsigned(dump.size()) > unsigned(count) * 0x20)
+        return;
+
+    const QByteArray erased(0x20, char(0xff));
+    for (unsigned i = 0; i + 0x20 <= unsigned(records.size()); i += 0x20) {
+        const QByteArray record = records.mid(i, 0x20);
+        dump += record;
+        if (record == erased)
+            return;
+        ++count;
+    }
+}
+
 QList<IgotuPoint> IgotuPoints::points() const
 {
     QList<IgotuPoint> result;
@@ -82,9 +82,16 @@ class IGOTU_EXPORT IgotuPoints
 {
     Q_DECLARE_TR_FUNCTIONS(igotu::IgotuPoints)
 public:
+    // empty, trackpoints can be added while they are downloaded
+    IgotuPoints();
     IgotuPoints(const QByteArray &dump, unsigned count);
     ~IgotuPoints();
 
+    // adds trackpoint records, e.g. a flash block from
+    // IgotuControl::contentsBlockRetrieved(); records after the first erased
+    // one are ignored
+    void append(const QByteArray &records);
+
     // all trackpoints
     QList<IgotuPoint> points() const;
     // isValid() && isWayPoint()
@@ -0,0 +1,248 @@
+/******************************************************************************
+ * Copyright (C) 2009  Michael Hofmann <mh21@mh21.de>                         *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License along    *
+ * with this program; if not, write to the Free Software Foundation, Inc.,    *
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.                *
+ ******************************************************************************/
+
+#include "igotutask.h"
+
+#include <QAtomicInt>
+#include <QMutex>
+#include <QWaitCondition>
+
+#include <climits>
+
+namespace igotu
+{
+
+class IgotuTaskPrivate
+{
+public:
+    unsigned id;
+    IgotuTask::Type type;
+
+    mutable QMutex lock;
+    QWaitCondition finished;
+    IgotuTask::State state;
+    bool cancel;
+    unsigned progress;
+    unsigned progressTotal;
+    QString message;
+    QString info;
+    QByteArray contents;
+    unsigned count;
+};
+
+static QAtomicInt lastTaskId;
+
+// IgotuTask ===================================================================
+
+IgotuTask::IgotuTask()
+{
+}
+
+IgotuTask::IgotuTask(Type type) :
+    d(new IgotuTaskPrivate)
+{
+    d->id = lastTaskId.fetchAndAddOrdered(1) + 1;
+    d->type = type;
+    d->state = Queued;
+    d->cancel = false;
+    d->progress = 0;
+    d->progressTotal = 0;
+    d->count = 0;
+}
+
+IgotuTask::~IgotuTask()
+{
+}
+
+bool IgotuTask::isValid() const
+{
+    return d.get() != NULL;
+}
+
+unsigned IgotuTask::id() const
+{
+    return d ? d->id : 0;
+}
+
+IgotuTask::Type IgotuTask::type() const
+{
+    return d ? d->type : Info;
+}
+
+IgotuTask::State IgotuTask::state() const
+{
+    if (!d)
+        return Failed;
+
+    QMutexLocker locker(&d->lock);
+    return d->state;
+}
+
+bool IgotuTask::isFinished() const
+{
+    const State current = state();
+    return current != Queued && current != Running;
+}
+
+void IgotuTask::cancel()
+{
+    if (!d)
+        return;
+
+    QMutexLocker locker(&d->lock);
+    d->cancel = true;
+}
+
+bool IgotuTask::isCancelRequested() const
+{
+    if (!d)
+        return false;
+
+    QMutexLocker locker(&d->lock);
+    return d->cancel;
+}
+
+unsigned IgotuTask::progress() const
+{
+    if (!d)
+        return 0;
+
+    QMutexLocker locker(&d->lock);
+    return d->progress;
+}
+
+unsigned IgotuTask::progressTotal() const
+{
+    if (!d)
+        return 0;
+
+    QMutexLocker locker(&d->lock);
+    return d->progressTotal;
+}
+
+QString IgotuTask::message() const
+{
+    if (!d)
+        return QString();
+
+    QMutexLocker locker(&d->lock);
+    return d->message;
+}
+
+QString IgotuTask::info() const
+{
+    if (!d)
+        return QString();
+
+    QMutexLocker locker(&d->lock);
+    return d->info;
+}
+
+QByteArray IgotuTask::contents() const
+{
+    if (!d)
+        return QByteArray();
+
+    QMutexLocker locker(&d->lock);
+    return d->contents;
+}
+
+unsigned IgotuTask::count() const
+{
+    if (!d)
+        return 0;
+
+    QMutexLocker locker(&d->lock);
+    return d->count;
+}
+
+bool IgotuTask::waitForFinished(int msecs) const
+{
+    if (!d)
+        return true;
+
+    QMutexLocker locker(&d->lock);
+    while (d->state == Queued || d->state == Running) {
+        if (!d->finished.wait(&d->lock,
+                    msecs < 0 ? ULONG_MAX : (unsigned long)msecs))
+            return false;
+    }
+    return true;
+}
+
+bool IgotuTask::operator==(const IgotuTask &other) const
+{
+    return d == other.d;
+}
+
+bool IgotuTask::operator!=(const IgotuTask &other) const
+{
+    return d != other.d;
+}
+
+void IgotuTask::setState(State state)
+{
+    if (!d)
+        return;
+
+    QMutexLocker locker(&d->lock);
+    d->state = state;
+    if (state != Queued && state != Running)
+        d->finished.wakeAll();
+}
+
+void IgotuTask::setMessage(const QString &message)
+{
+    if (!d)
+        return;
+
+    QMutexLocker locker(&d->lock);
+    d->message = message;
+}
+
+void IgotuTask::setProgress(unsigned num, unsigned total)
+{
+    if (!d)
+        return;
+
+    QMutexLocker locker(&d->lock);
+    d->progress = num;
+    d->progressTotal = total;
+}
+
+void IgotuTask::setInfo(const QString &info, const QByteArray &contents)
+{
+    if (!d)
+        return;
+
+    QMutexLocker locker(&d->lock);
+    d->info = info;
+    d->contents = contents;
+}
+
+void IgotuTask::setContents(const QByteArray &contents, unsigned count)
+{
+    if (!d)
+        return;
+
+    QMutexLocker locker(&d->lock);
+    d->contents = contents;
+    d->count = count;
+}
+
+} // namespace igotu
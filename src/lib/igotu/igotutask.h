@@ -0,0 +1,111 @@
+/******************************************************************************
+ * Copyright (C) 2009  Michael Hofmann <mh21@mh21.de>                         *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License along    *
+ * with this program; if not, write to the Free Software Foundation, Inc.,    *
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.                *
+ ******************************************************************************/
+
+#ifndef _IGOTU2GPX_SRC_IGOTU_IGOTUTASK_H_
+#define _IGOTU2GPX_SRC_IGOTU_IGOTUTASK_H_
+
+#include "global.h"
+
+#include <boost/shared_ptr.hpp>
+
+#include <QMetaType>
+#include <QString>
+
+namespace igotu
+{
+
+class IgotuTaskPrivate;
+
+// Handle for a task queued by IgotuControl. Copies refer to the same task,
+// all methods can be called from any thread. Progress and results are
+// available here as well as through the signals of IgotuControl.
+class IGOTU_EXPORT IgotuTask
+{
+    friend class IgotuControl;
+    friend class IgotuControlPrivate;
+    friend class IgotuControlPrivateWorker;
+public:
+    enum Type {
+        Info,
+        Contents,
+        Purge,
+        Reset,
+        Configure
+    };
+
+    enum State {
+        Queued,
+        Running,
+        Succeeded,
+        Failed,
+        Cancelled
+    };
+
+    // invalid task
+    IgotuTask();
+    ~IgotuTask();
+
+    bool isValid() const;
+    // unique for each task of the process
+    unsigned id() const;
+    Type type() const;
+    State state() const;
+    bool isFinished() const;
+
+    // only this task is cancelled, a queued task finishes as soon as it is
+    // processed without accessing the GPS tracker
+    void cancel();
+    bool isCancelRequested() const;
+
+    // num: 0 to total
+    unsigned progress() const;
+    unsigned progressTotal() const;
+    // message of the current command, error message for failed tasks
+    QString message() const;
+
+    // info and configure: human readable configuration
+    QString info() const;
+    // info and configure: configuration block, contents: flash memory
+    QByteArray contents() const;
+    // contents: number of trackpoints
+    unsigned count() const;
+
+    // returns false if the task has not finished after msecs, -1 waits
+    // without a time limit
+    bool waitForFinished(int msecs = -1) const;
+
+    bool operator==(const IgotuTask &other) const;
+    bool operator!=(const IgotuTask &other) const;
+
+private:
+    IgotuTask(Type type);
+
+    void setState(State state);
+    void setMessage(const QString &message);
+    void setProgress(unsigned num, unsigned total);
+    void setInfo(const QString &info, const QByteArray &contents);
+    void setContents(const QByteArray &contents, unsigned count);
+
+    boost::shared_ptr<IgotuTaskPrivate> d;
+};
+
+} // namespace igotu
+
+Q_DECLARE_METATYPE(igotu::IgotuTask)
+
+#endif
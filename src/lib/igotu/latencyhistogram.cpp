@@ -0,0 +1,129 @@
+/******************************************************************************
+ * Copyright (C) 2009  Michael Hofmann <mh21@mh21.de>                         *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License along    *
+ * with this program; if not, write to the Free Software Foundation, Inc.,    *
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.                *
+ ******************************************************************************/
+
+#include "latencyhistogram.h"
+
+#include <cmath>
+
+namespace igotu
+{
+
+// values below this have a bucket of their own
+static const unsigned linearBuckets = 16;
+// durations up to about 12 days
+static const unsigned maximumExponent = 40;
+static const unsigned bucketCount =
+    linearBuckets + (maximumExponent - 3) * 8;
+
+// LatencyHistogram ============================================================
+
+LatencyHistogram::LatencyHistogram() :
+    buckets(bucketCount),
+    samples(0),
+    time(0),
+    bytes(0),
+    longest(0)
+{
+}
+
+unsigned LatencyHistogram::bucket(quint64 usecs)
+{
+    if (usecs < linearBuckets)
+        return usecs;
+    unsigned exponent = 4;
+    while (exponent < maximumExponent && (usecs >> (exponent + 1)) != 0)
+        ++exponent;
+    if ((usecs >> (exponent + 1)) != 0)
+        return bucketCount - 1;
+    // the three bits below the highest one select the bucket
+    return linearBuckets + (exponent - 4) * 8 +
+        ((usecs >> (exponent - 3)) & 7);
+}
+
+quint64 LatencyHistogram::bucketLimit(unsigned bucket)
+{
+    if (bucket < linearBuckets)
+        return bucket;
+    const unsigned exponent = (bucket - linearBuckets) / 8 + 4;
+    const unsigned step = (bucket - linearBuckets) % 8;
+    return ((quint64(8 + step + 1)) << (exponent - 3)) - 1;
+}
+
+void LatencyHistogram::add(quint64 usecs, quint64 bytes)
+{
+    ++buckets[bucket(usecs)];
+    ++samples;
+    time += usecs;
+    this->bytes += bytes;
+    longest = qMax(longest, usecs);
+}
+
+void LatencyHistogram::add(const LatencyHistogram &other)
+{
+    for (unsigned i = 0; i < bucketCount; ++i)
+        buckets[i] += other.buckets[i];
+    samples += other.samples;
+    time += other.time;
+    bytes += other.bytes;
+    longest = qMax(longest, other.longest);
+}
+
+unsigned LatencyHistogram::count() const
+{
+    return samples;
+}
+
+quint64 LatencyHistogram::totalTime() const
+{
+    return time;
+}
+
+quint64 LatencyHistogram::totalBytes() const
+{
+    return bytes;
+}
+
+quint64 LatencyHistogram::maximum() const
+{
+    return longest;
+}
+
+quint64 LatencyHistogram::percentile(double percent) const
+{
+    if (samples == 0)
+        return 0;
+    const unsigned rank = qBound(1u,
+            unsigned(ceil(samples * percent / 100.0)), samples);
+    unsigned seen = 0;
+    for (unsigned i = 0; i < bucketCount; ++i) {
+        seen += buckets[i];
+        // the last bucket also contains all longer durations
+        if (seen >= rank && i + 1 < bucketCount)
+            return qMin(bucketLimit(i), longest);
+    }
+    return longest;
+}
+
+double LatencyHistogram::throughput() const
+{
+    if (time == 0)
+        return 0;
+    return bytes * 1e6 / time;
+}
+
+} // namespace igotu
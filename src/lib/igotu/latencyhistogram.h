@@ -0,0 +1,62 @@
+/******************************************************************************
+ * Copyright (C) 2009  Michael Hofmann <mh21@mh21.de>                         *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License along    *
+ * with this program; if not, write to the Free Software Foundation, Inc.,    *
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.                *
+ ******************************************************************************/
+
+#ifndef _IGOTU2GPX_SRC_IGOTU_LATENCYHISTOGRAM_H_
+#define _IGOTU2GPX_SRC_IGOTU_LATENCYHISTOGRAM_H_
+
+#include "global.h"
+
+#include <QVector>
+
+namespace igotu
+{
+
+// Histogram of durations in microseconds with logarithmic buckets, eight
+// buckets per power of two so that percentiles are accurate to 12.5%
+class IGOTU_EXPORT LatencyHistogram
+{
+public:
+    LatencyHistogram();
+
+    void add(quint64 usecs, quint64 bytes = 0);
+    void add(const LatencyHistogram &other);
+
+    unsigned count() const;
+    quint64 totalTime() const;
+    quint64 totalBytes() const;
+    quint64 maximum() const;
+    // upper bound of the bucket that contains the given percentile (0-100),
+    // never more than the maximum
+    quint64 percentile(double percent) const;
+    // bytes per second of all added durations, 0 if no time elapsed
+    double throughput() const;
+
+private:
+    static unsigned bucket(quint64 usecs);
+    static quint64 bucketLimit(unsigned bucket);
+
+    QVector<unsigned> buckets;
+    unsigned samples;
+    quint64 time;
+    quint64 bytes;
+    quint64 longest;
+};
+
+} // namespace igotu
+
+#endif
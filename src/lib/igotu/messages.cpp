@@ -18,41 +18,230 @@
 
 #include "messages.h"
 
+#include <QAtomicInt>
+#include <QCoreApplication>
 #include <QMutex>
 #include <QString>
+#include <QThread>
+#include <QWaitCondition>
 
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
 #include <iostream>
 
 namespace igotu
 {
 
+// Writes messages to stderr in the background, so that callers never wait for
+// a slow terminal; consecutive messages are written and flushed at once. The
+// thread is started with the first message after the application object has
+// been created and stopped by a post routine of the application, messages
+// before and after that are written directly. Qt messages are routed through
+// the writer while it runs, so that they keep their order.
+class LogWriter : public QThread
+{
+public:
+    LogWriter();
+
+    void append(const QByteArray &data);
+    // Blocks until everything appended so far has been written
+    void flush();
+    // Writes everything appended so far without the thread, for fatal errors
+    // where the thread might not get to run any more
+    void writePending();
+    // Writes the remaining messages and stops the thread; afterwards,
+    // messages are written directly
+    void stop();
+
+protected:
+    virtual void run();
+
+private:
+    // Expects the lock to be held
+    void startThread();
+
+    QMutex lock;
+    QWaitCondition dataAvailable;
+    QWaitCondition dataWritten;
+    QByteArray pending;
+    bool writing;
+    bool started;
+    bool stopped;
+};
+
 class MessagesPrivate
 {
 public:
-    MessagesPrivate() :
-        level(0)
-    {
-    }
+    MessagesPrivate();
+    ~MessagesPrivate();
 
-    int verbose()
+    // no lock needed, this is checked before every verbose message
+    int verbose() const
     {
-        QMutexLocker locker(&lock);
         return level;
     }
 
     void setVerbose(int value)
     {
-        QMutexLocker locker(&lock);
-        level = value;
+        level.fetchAndStoreOrdered(value);
     }
 
+    LogWriter * const writer;
+
 private:
-    int level;
-    QMutex lock;
+    QAtomicInt level;
 };
 
 Q_GLOBAL_STATIC(MessagesPrivate, messagesPrivate)
 
+MessagesPrivate::MessagesPrivate() :
+    writer(new LogWriter),
+    level(0)
+{
+}
+
+MessagesPrivate::~MessagesPrivate()
+{
+    // Only still running if the application object was never destroyed,
+    // e.g. after exit(); joining the thread from a static destructor is
+    // unsafe (on Windows, it might already be gone at DLL unload), so the
+    // writer is left alone
+    if (!writer->isRunning())
+        delete writer;
+}
+
+static QtMsgHandler previousMessageHandler = NULL;
+static std::terminate_handler previousTerminateHandler = NULL;
+
+static void logMessageHandler(QtMsgType type, const char *message)
+{
+    LogWriter * const writer = messagesPrivate()->writer;
+    writer->append(QByteArray(message) + '\n');
+    switch (type) {
+    case QtCriticalMsg:
+        writer->flush();
+        break;
+    case QtFatalMsg:
+        writer->writePending();
+        abort();
+    default:
+        break;
+    }
+}
+
+static void logTerminateHandler()
+{
+    messagesPrivate()->writer->writePending();
+    if (previousTerminateHandler)
+        previousTerminateHandler();
+    abort();
+}
+
+static void stopLogWriter()
+{
+    messagesPrivate()->writer->stop();
+}
+
+// LogWriter ===================================================================
+
+LogWriter::LogWriter() :
+    writing(false),
+    started(false),
+    stopped(false)
+{
+}
+
+void LogWriter::startThread()
+{
+    started = true;
+    // Messages written directly so far are already on stderr
+    start();
+    qAddPostRoutine(stopLogWriter);
+    // An application that installed its own handler keeps it
+    previousMessageHandler = qInstallMsgHandler(logMessageHandler);
+    if (previousMessageHandler)
+        qInstallMsgHandler(previousMessageHandler);
+    previousTerminateHandler = std::set_terminate(logTerminateHandler);
+}
+
+void LogWriter::append(const QByteArray &data)
+{
+    QMutexLocker locker(&lock);
+
+    if (!started && !stopped && QCoreApplication::instance())
+        startThread();
+    if (!started || stopped) {
+        // Messages queued before stop() come first
+        while (!pending.isEmpty() || writing)
+            dataWritten.wait(&lock);
+        fwrite(data.constData(), 1, data.size(), stderr);
+        fflush(stderr);
+        return;
+    }
+    pending += data;
+    dataAvailable.wakeAll();
+}
+
+void LogWriter::flush()
+{
+    QMutexLocker locker(&lock);
+
+    while (!pending.isEmpty() || writing)
+        dataWritten.wait(&lock);
+}
+
+void LogWriter::writePending()
+{
+    // The lock might be held by a thread that does not return
+    if (!lock.tryLock(100))
+        return;
+    fwrite(pending.constData(), 1, pending.size(), stderr);
+    fflush(stderr);
+    pending.clear();
+    lock.unlock();
+}
+
+void LogWriter::stop()
+{
+    {
+        QMutexLocker locker(&lock);
+        if (!started || stopped)
+            return;
+        stopped = true;
+        dataAvailable.wakeAll();
+    }
+    wait();
+
+    if (!previousMessageHandler)
+        qInstallMsgHandler(NULL);
+    std::set_terminate(previousTerminateHandler);
+}
+
+void LogWriter::run()
+{
+    QMutexLocker locker(&lock);
+
+    Q_FOREVER {
+        while (pending.isEmpty() && !stopped)
+            dataAvailable.wait(&lock);
+        if (pending.isEmpty())
+            return;
+
+        const QByteArray data = pending;
+        pending.clear();
+        writing = true;
+        locker.unlock();
+        fwrite(data.constData(), 1, data.size(), stderr);
+        fflush(stderr);
+        locker.relock();
+        writing = false;
+        dataWritten.wakeAll();
+    }
+}
+
+// Messages ====================================================================
+
 int Messages::verbose()
 {
     return messagesPrivate()->verbose();
@@ -65,35 +254,40 @@ void Messages::setVerbose(int value)
 
 void Messages::errorMessage(const QString &message)
 {
-    std::cerr << qPrintable(message) << std::endl;
+    // errors might be followed by a crash or exit, make sure they are seen
+    messagesPrivate()->writer->append(message.toLocal8Bit() + '\n');
+    messagesPrivate()->writer->flush();
 }
 
 void Messages::normalMessage(const QString &message)
 {
     if (messagesPrivate()->verbose() >= 0)
-        std::cerr << qPrintable(message) << std::endl;
+        messagesPrivate()->writer->append(message.toLocal8Bit() + '\n');
 }
 
 void Messages::verboseMessage(const QString &message)
 {
     if (messagesPrivate()->verbose() >= 1)
-        std::cerr << qPrintable(message) << std::endl;
+        messagesPrivate()->writer->append(message.toLocal8Bit() + '\n');
 }
 
 void Messages::textOutput(const QString &message)
 {
+    // keep the order of messages and output on a terminal
+    messagesPrivate()->writer->flush();
     std::cout << qPrintable(message) << std::endl;
 }
 
 void Messages::directOutput(const QByteArray &data)
 {
+    messagesPrivate()->writer->flush();
     std::cout << std::string(data.data(), data.length());
 }
 
 void Messages::normalMessagePart(const QString &message)
 {
     if (messagesPrivate()->verbose() >= 0)
-        std::cerr << qPrintable(message) << std::flush;
+        messagesPrivate()->writer->append(message.toLocal8Bit());
 }
 
 } // namespace igotu
@@ -234,6 +234,21 @@ QString Paths::mainDataDirectory()
     return result;
 }
 
+QString Paths::cacheDirectory()
+{
+    QString result;
+#if defined(Q_OS_UNIX)
+    result = directoriesFromEnvironment("XDG_CACHE_HOME",
+            QDir::homePath() + QLatin1String("/.cache"), DIRECTORY).value(0);
+#elif defined(Q_OS_WIN)
+    result = windowsConfigPath(CSIDL_APPDATA) + DIRECTORY +
+            QLatin1String("/cache");
+#else
+#error No idea where to put the cache directory on this platform
+#endif
+    return result;
+}
+
 QStringList Paths::pluginDirectories()
 {
     QStringList result;
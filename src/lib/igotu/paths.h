@@ -36,6 +36,9 @@ public:
     static QStringList pluginDirectories();
     static QStringList iconDirectories();
     static QStringList translationDirectories();
+
+    // user specific directory for cached data, might not exist yet
+    static QString cacheDirectory();
 };
 
 } // namespace igotu
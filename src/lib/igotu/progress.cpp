@@ -0,0 +1,186 @@
+/******************************************************************************
+ * Copyright (C) 2009  Michael Hofmann <mh21@mh21.de>                         *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License along    *
+ * with this program; if not, write to the Free Software Foundation, Inc.,    *
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.                *
+ ******************************************************************************/
+
+#include "progress.h"
+
+#include <cmath>
+
+namespace igotu
+{
+
+// time constant of the current rate in us
+static const double rateWindow = 2e6;
+
+static QString humanBytes(quint64 bytes)
+{
+    if (bytes < 10 * 1024)
+        return Progress::tr("%1 B").arg(bytes);
+    if (bytes < 10 * 1024 * 1024)
+        return Progress::tr("%1 KiB").arg(bytes / 1024.0, 0, 'f', 1);
+    return Progress::tr("%1 MiB").arg(bytes / (1024.0 * 1024.0), 0, 'f', 1);
+}
+
+// Progress ====================================================================
+
+Progress::Progress() :
+    currentPhase(Identify),
+    transferred(0),
+    total(0),
+    startTime(0),
+    lastTime(0),
+    rate(0)
+{
+}
+
+void Progress::start(Phase phase, quint64 totalBytes, quint64 usecs)
+{
+    currentPhase = phase;
+    transferred = 0;
+    total = totalBytes;
+    startTime = usecs;
+    lastTime = usecs;
+    rate = 0;
+}
+
+void Progress::update(quint64 bytes, quint64 usecs)
+{
+    if (usecs > lastTime && bytes >= transferred) {
+        const double interval = usecs - lastTime;
+        const double sample = (bytes - transferred) * 1e6 / interval;
+        // Exponential moving average weighted by the interval
+        const double weight = 1 - std::exp(-interval / rateWindow);
+        rate = lastTime == startTime ? sample :
+            rate + weight * (sample - rate);
+        lastTime = usecs;
+    }
+    transferred = bytes;
+}
+
+void Progress::setTotalBytes(quint64 totalBytes)
+{
+    total = totalBytes;
+}
+
+Progress::Phase Progress::phase() const
+{
+    return currentPhase;
+}
+
+QString Progress::phaseName() const
+{
+    switch (currentPhase) {
+    case Identify:
+        return QLatin1String("identify");
+    case Count:
+        return QLatin1String("count");
+    case Read:
+        return QLatin1String("read");
+    case Erase:
+        return QLatin1String("erase");
+    case Program:
+        return QLatin1String("program");
+    }
+    return QString();
+}
+
+quint64 Progress::bytes() const
+{
+    return transferred;
+}
+
+quint64 Progress::totalBytes() const
+{
+    return total;
+}
+
+unsigned Progress::elapsed() const
+{
+    return (lastTime - startTime) / 1000;
+}
+
+double Progress::currentRate() const
+{
+    return rate;
+}
+
+double Progress::averageRate() const
+{
+    if (lastTime == startTime)
+        return 0;
+    return transferred * 1e6 / (lastTime - startTime);
+}
+
+int Progress::eta() const
+{
+    if (transferred >= total)
+        return total > 0 ? 0 : -1;
+    const double speed = rate > 0 ? rate : averageRate();
+    if (speed <= 0)
+        return -1;
+    return int(std::ceil((total - transferred) / speed));
+}
+
+QString Progress::toString() const
+{
+    QString result;
+    switch (currentPhase) {
+    case Identify:
+        result = tr("Identifying");
+        break;
+    case Count:
+        result = tr("Counting trackpoints");
+        break;
+    case Read:
+        result = tr("Reading");
+        break;
+    case Erase:
+        result = tr("Erasing");
+        break;
+    case Program:
+        result = tr("Programming");
+        break;
+    }
+    if (total == 0)
+        return result;
+
+    result += tr(": %1 of %2").arg(humanBytes(transferred),
+            humanBytes(total));
+    if (lastTime != startTime)
+        result += tr(", %1/s (average %2/s)")
+            .arg(humanBytes(quint64(rate)),
+                    humanBytes(quint64(averageRate())));
+    const int remaining = eta();
+    if (remaining >= 0)
+        result += tr(", %1:%2 remaining").arg(remaining / 60)
+            .arg(remaining % 60, 2, 10, QLatin1Char('0'));
+    return result;
+}
+
+QString Progress::toJson() const
+{
+    return QString::fromLatin1("{\"phase\":\"%1\",\"bytes\":%2,\"total\":%3,"
+            "\"rate\":%4,\"average\":%5,\"eta\":%6}")
+        .arg(phaseName())
+        .arg(transferred)
+        .arg(total)
+        .arg(rate, 0, 'f', 0)
+        .arg(averageRate(), 0, 'f', 0)
+        .arg(eta());
+}
+
+} // namespace igotu
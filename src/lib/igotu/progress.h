@@ -0,0 +1,85 @@
+/******************************************************************************
+ * Copyright (C) 2009  Michael Hofmann <mh21@mh21.de>                         *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License along    *
+ * with this program; if not, write to the Free Software Foundation, Inc.,    *
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.                *
+ ******************************************************************************/
+
+#ifndef _IGOTU2GPX_SRC_IGOTU_PROGRESS_H_
+#define _IGOTU2GPX_SRC_IGOTU_PROGRESS_H_
+
+#include "global.h"
+
+#include <QCoreApplication>
+#include <QMetaType>
+
+namespace igotu
+{
+
+// Progress of the current phase of an IgotuControl task with transfer rates
+// and the estimated remaining time
+class IGOTU_EXPORT Progress
+{
+    Q_DECLARE_TR_FUNCTIONS(igotu::Progress)
+public:
+    enum Phase {
+        Identify,
+        Count,
+        Read,
+        Erase,
+        Program
+    };
+
+    Progress();
+
+    // starts a new phase at the given time, resets all counters
+    void start(Phase phase, quint64 totalBytes, quint64 usecs);
+    // bytes transferred so far in this phase at the given time
+    void update(quint64 bytes, quint64 usecs);
+    // e.g. if part of the data turns out to be available without a transfer
+    void setTotalBytes(quint64 totalBytes);
+
+    Phase phase() const;
+    // identify, count, read, erase or program
+    QString phaseName() const;
+
+    quint64 bytes() const;
+    quint64 totalBytes() const;
+    // time since the start of the phase in ms
+    unsigned elapsed() const;
+    // in bytes/s, the current rate is averaged over about two seconds
+    double currentRate() const;
+    double averageRate() const;
+    // remaining time in s, -1 if unknown
+    int eta() const;
+
+    // for the status bar, phases without a known size only show the phase
+    QString toString() const;
+    // single line JSON object, keys phase, bytes, total, rate, average, eta
+    QString toJson() const;
+
+private:
+    Phase currentPhase;
+    quint64 transferred;
+    quint64 total;
+    quint64 startTime;
+    quint64 lastTime;
+    double rate;
+};
+
+} // namespace igotu
+
+Q_DECLARE_METATYPE(igotu::Progress)
+
+#endif
@@ -0,0 +1,200 @@
+/******************************************************************************
+ * Copyright (C) 2009  Michael Hofmann <mh21@mh21.de>                         *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License along    *
+ * with this program; if not, write to the Free Software Foundation, Inc.,    *
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.                *
+ ******************************************************************************/
+
+
+#include "exception.h"
+#include "retrypolicy.h"
+
+#include <QMutex>
+#include <QStringList>
+#include <QThreadStorage>
+
+#include <cmath>
+
+namespace igotu
+{
+
+static QThreadStorage<RetryPolicy*> currentPolicies;
+
+static QMutex retryCountLock;
+static QMap<QString, unsigned> retryCountMaps[RetryPolicy::ErrorClassCount];
+
+// RetryPolicy =================================================================
+
+RetryPolicy::RetryPolicy() :
+    firstDelay(10),
+    maxDelay(250),
+    delayFactor(2.0),
+    delayJitter(0.25),
+    timeLimit(0)
+{
+    maxRetries[ProtocolError] = 5;
+    maxRetries[DeviceError] = 3;
+}
+
+unsigned RetryPolicy::retries(ErrorClass errorClass) const
+{
+    return maxRetries[errorClass];
+}
+
+void RetryPolicy::setRetries(ErrorClass errorClass, unsigned retries)
+{
+    maxRetries[errorClass] = retries;
+}
+
+unsigned RetryPolicy::initialDelay() const
+{
+    return firstDelay;
+}
+
+void RetryPolicy::setInitialDelay(unsigned msecs)
+{
+    firstDelay = msecs;
+}
+
+unsigned RetryPolicy::maximumDelay() const
+{
+    return maxDelay;
+}
+
+void RetryPolicy::setMaximumDelay(unsigned msecs)
+{
+    maxDelay = msecs;
+}
+
+double RetryPolicy::factor() const
+{
+    return delayFactor;
+}
+
+void RetryPolicy::setFactor(double factor)
+{
+    delayFactor = factor;
+}
+
+double RetryPolicy::jitter() const
+{
+    return delayJitter;
+}
+
+void RetryPolicy::setJitter(double jitter)
+{
+    delayJitter = jitter;
+}
+
+unsigned RetryPolicy::deadline() const
+{
+    return timeLimit;
+}
+
+void RetryPolicy::setDeadline(unsigned msecs)
+{
+    timeLimit = msecs;
+}
+
+unsigned RetryPolicy::delay(unsigned retry) const
+{
+    if (retry == 0)
+        return 0;
+
+    double result = qMin(double(maxDelay),
+            firstDelay * std::pow(delayFactor, double(retry - 1)));
+    if (delayJitter > 0)
+        result *= 1.0 + delayJitter * (2.0 * qrand() / RAND_MAX - 1.0);
+    return qMax(0, qRound(result));
+}
+
+RetryPolicy RetryPolicy::fromString(const QString &policy)
+{
+    RetryPolicy result;
+    Q_FOREACH (const QString &part, policy.split(QLatin1Char(','),
+                QString::SkipEmptyParts)) {
+        const QString name = part.section(QLatin1Char('='), 0, 0).trimmed();
+        const QString value = part.section(QLatin1Char('='), 1).trimmed();
+        bool ok = false;
+        if (name == QLatin1String("protocol")) {
+            result.setRetries(ProtocolError, value.toUInt(&ok));
+        } else if (name == QLatin1String("device")) {
+            result.setRetries(DeviceError, value.toUInt(&ok));
+        } else if (name == QLatin1String("delay")) {
+            result.setInitialDelay(value.toUInt(&ok));
+        } else if (name == QLatin1String("maxdelay")) {
+            result.setMaximumDelay(value.toUInt(&ok));
+        } else if (name == QLatin1String("factor")) {
+            result.setFactor(value.toDouble(&ok));
+            ok = ok && result.factor() >= 1.0;
+        } else if (name == QLatin1String("jitter")) {
+            result.setJitter(value.toDouble(&ok));
+            ok = ok && result.jitter() >= 0.0 && result.jitter() <= 1.0;
+        } else if (name == QLatin1String("deadline")) {
+            result.setDeadline(value.toUInt(&ok));
+        } else {
+            throw Exception(tr("Unknown retry policy parameter: %1")
+                    .arg(name));
+        }
+        if (!ok)
+            throw Exception(tr("Invalid value for retry policy parameter "
+                        "%1: %2").arg(name, value));
+    }
+    return result;
+}
+
+QString RetryPolicy::toString() const
+{
+    return QString::fromLatin1("protocol=%1,device=%2,delay=%3,maxdelay=%4,"
+            "factor=%5,jitter=%6,deadline=%7")
+        .arg(maxRetries[ProtocolError]).arg(maxRetries[DeviceError])
+        .arg(firstDelay).arg(maxDelay).arg(delayFactor).arg(delayJitter)
+        .arg(timeLimit);
+}
+
+RetryPolicy RetryPolicy::currentPolicy()
+{
+    if (!currentPolicies.hasLocalData())
+        return RetryPolicy();
+    return *currentPolicies.localData();
+}
+
+void RetryPolicy::setCurrentPolicy(const RetryPolicy &policy)
+{
+    currentPolicies.setLocalData(new RetryPolicy(policy));
+}
+
+void RetryPolicy::recordRetry(const QString &command, ErrorClass errorClass)
+{
+    QMutexLocker locker(&retryCountLock);
+
+    ++retryCountMaps[errorClass][command];
+}
+
+QMap<QString, unsigned> RetryPolicy::retryCounts(ErrorClass errorClass)
+{
+    QMutexLocker locker(&retryCountLock);
+
+    return retryCountMaps[errorClass];
+}
+
+void RetryPolicy::resetRetryCounts()
+{
+    QMutexLocker locker(&retryCountLock);
+
+    for (unsigned i = 0; i < ErrorClassCount; ++i)
+        retryCountMaps[i].clear();
+}
+
+} // namespace igotu
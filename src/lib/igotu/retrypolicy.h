@@ -0,0 +1,94 @@
+/******************************************************************************
+ * Copyright (C) 2009  Michael Hofmann <mh21@mh21.de>                         *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License along    *
+ * with this program; if not, write to the Free Software Foundation, Inc.,    *
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.                *
+ ******************************************************************************/
+
+
+#ifndef _IGOTU2GPX_SRC_IGOTU_RETRYPOLICY_H_
+#define _IGOTU2GPX_SRC_IGOTU_RETRYPOLICY_H_
+
+#include "global.h"
+
+#include <QCoreApplication>
+#include <QMap>
+
+namespace igotu
+{
+
+// Determines how often and when IgotuCommand retries failed commands
+class IGOTU_EXPORT RetryPolicy
+{
+    Q_DECLARE_TR_FUNCTIONS(igotu::RetryPolicy)
+public:
+    enum ErrorClass {
+        // invalid or missing responses, e.g. caused by NMEA sentences
+        ProtocolError,
+        // error codes returned by the GPS tracker
+        DeviceError,
+        ErrorClassCount
+    };
+
+    RetryPolicy();
+
+    // number of retries for each error class
+    unsigned retries(ErrorClass errorClass) const;
+    void setRetries(ErrorClass errorClass, unsigned retries);
+
+    // delay before the first retry (ms), doubled (factor) for every further
+    // retry up to maximumDelay
+    unsigned initialDelay() const;
+    void setInitialDelay(unsigned msecs);
+    unsigned maximumDelay() const;
+    void setMaximumDelay(unsigned msecs);
+    double factor() const;
+    void setFactor(double factor);
+    // random variation of the delays, 0.25 means +-25%
+    double jitter() const;
+    void setJitter(double jitter);
+    // no retries are started after this time (ms) since the first try,
+    // 0 means no deadline
+    unsigned deadline() const;
+    void setDeadline(unsigned msecs);
+
+    // delay before the given retry (ms), retry is 1 for the first one
+    unsigned delay(unsigned retry) const;
+
+    // comma separated list of name=value pairs, names are protocol, device,
+    // delay, maxdelay, factor, jitter and deadline
+    static RetryPolicy fromString(const QString &policy);
+    QString toString() const;
+
+    // policy used by IgotuCommand instances created in the current thread
+    static RetryPolicy currentPolicy();
+    static void setCurrentPolicy(const RetryPolicy &policy);
+
+    // number of retries per command name for an error class, for all threads
+    static void recordRetry(const QString &command, ErrorClass errorClass);
+    static QMap<QString, unsigned> retryCounts(ErrorClass errorClass);
+    static void resetRetryCounts();
+
+private:
+    unsigned maxRetries[ErrorClassCount];
+    unsigned firstDelay;
+    unsigned maxDelay;
+    double delayFactor;
+    double delayJitter;
+    unsigned timeLimit;
+};
+
+} // namespace igotu
+
+#endif
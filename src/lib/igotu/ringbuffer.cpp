@@ -0,0 +1,104 @@
+/******************************************************************************
+ * Copyright (C) 2009  Michael Hofmann <mh21@mh21.de>                         *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License along    *
+ * with this program; if not, write to the Free Software Foundation, Inc.,    *
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.                *
+ ******************************************************************************/
+
+
+#include "ringbuffer.h"
+
+#include <cstring>
+
+namespace igotu
+{
+
+// RingBuffer ==================================================================
+
+RingBuffer::RingBuffer(unsigned capacity) :
+    buffer(qMax(1u, capacity), 0),
+    head(0),
+    count(0)
+{
+}
+
+unsigned RingBuffer::size() const
+{
+    return count;
+}
+
+bool RingBuffer::isEmpty() const
+{
+    return count == 0;
+}
+
+void RingBuffer::clear()
+{
+    head = 0;
+    count = 0;
+}
+
+void RingBuffer::append(const char *data, unsigned size)
+{
+    reserve(count + size);
+
+    const unsigned capacity = buffer.size();
+    const unsigned tail = (head + count) % capacity;
+    const unsigned first = qMin(size, capacity - tail);
+    memcpy(buffer.data() + tail, data, first);
+    memcpy(buffer.data(), data + first, size - first);
+    count += size;
+}
+
+void RingBuffer::append(const QByteArray &data)
+{
+    append(data.constData(), data.size());
+}
+
+unsigned RingBuffer::read(char *data, unsigned size)
+{
+    size = qMin(size, count);
+
+    const unsigned capacity = buffer.size();
+    const unsigned first = qMin(size, capacity - head);
+    memcpy(data, buffer.constData() + head, first);
+    memcpy(data + first, buffer.constData(), size - first);
+    return skip(size);
+}
+
+unsigned RingBuffer::skip(unsigned size)
+{
+    size = qMin(size, count);
+    head = (head + size) % buffer.size();
+    count -= size;
+    if (count == 0)
+        head = 0;
+    return size;
+}
+
+void RingBuffer::reserve(unsigned size)
+{
+    const unsigned capacity = buffer.size();
+    if (size <= capacity)
+        return;
+
+    QByteArray grown(qMax(size, 2 * capacity), 0);
+    const unsigned first = qMin(count, capacity - head);
+    memcpy(grown.data(), buffer.constData() + head, first);
+    memcpy(grown.data() + first, buffer.constData(), count - first);
+    buffer = grown;
+    head = 0;
+}
+
+} // namespace igotu
@@ -0,0 +1,60 @@
+/******************************************************************************
+ * Copyright (C) 2009  Michael Hofmann <mh21@mh21.de>                         *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License along    *
+ * with this program; if not, write to the Free Software Foundation, Inc.,    *
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.                *
+ ******************************************************************************/
+
+
+#ifndef _IGOTU2GPX_SRC_IGOTU_RINGBUFFER_H_
+#define _IGOTU2GPX_SRC_IGOTU_RINGBUFFER_H_
+
+#include "global.h"
+
+#include <QByteArray>
+
+namespace igotu
+{
+
+// FIFO byte buffer for data connections, grows if necessary but never moves
+// the remaining data on reads
+class IGOTU_EXPORT RingBuffer
+{
+public:
+    RingBuffer(unsigned capacity = 0x100);
+
+    unsigned size() const;
+    bool isEmpty() const;
+    void clear();
+
+    void append(const char *data, unsigned size);
+    void append(const QByteArray &data);
+
+    // Copies up to size bytes to data and removes them from the buffer,
+    // returns the number of bytes copied
+    unsigned read(char *data, unsigned size);
+    // Removes up to size bytes, returns the number of bytes removed
+    unsigned skip(unsigned size);
+
+private:
+    void reserve(unsigned size);
+
+    QByteArray buffer;
+    unsigned head;
+    unsigned count;
+};
+
+} // namespace igotu
+
+#endif
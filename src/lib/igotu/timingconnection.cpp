@@ -0,0 +1,193 @@
+/******************************************************************************
+ * Copyright (C) 2009  Michael Hofmann <mh21@mh21.de>                         *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License along    *
+ * with this program; if not, write to the Free Software Foundation, Inc.,    *
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.                *
+ ******************************************************************************/
+
+#include "igotucommand.h"
+#include "timingconnection.h"
+#include "utils.h"
+
+#include <QAtomicInt>
+#include <QMutex>
+#include <QSet>
+#include <QThreadStorage>
+
+namespace igotu
+{
+
+// Allocated once per thread and reused by all command scopes
+static QThreadStorage<QString*> currentCommands;
+// Number of existing TimingConnection instances
+static QAtomicInt timingConnections;
+
+static QMutex statisticsLock;
+static QMap<QString, LatencyHistogram>
+    statisticsMaps[TimingConnection::OperationCount];
+
+// Put translations in the right context
+//
+// TRANSLATOR igotu::TimingConnection
+
+static QString milliseconds(quint64 usecs)
+{
+    return TimingConnection::tr("%1 ms").arg(usecs / 1000.0, 0, 'f', 1);
+}
+
+static QString &threadCommand()
+{
+    if (!currentCommands.hasLocalData())
+        currentCommands.setLocalData(new QString);
+    return *currentCommands.localData();
+}
+
+// TimingConnection::CommandScope ==============================================
+
+TimingConnection::CommandScope::CommandScope(const IgotuCommand *command) :
+    active(isEnabled())
+{
+    // The command name is only needed for statistics
+    if (!active)
+        return;
+    QString &current = threadCommand();
+    previous = current;
+    current = command->commandName();
+}
+
+TimingConnection::CommandScope::~CommandScope()
+{
+    if (active)
+        threadCommand() = previous;
+}
+
+// TimingConnection ============================================================
+
+TimingConnection::TimingConnection(DataConnection *connection) :
+    connection(connection)
+{
+    timingConnections.ref();
+}
+
+TimingConnection::~TimingConnection()
+{
+    timingConnections.deref();
+}
+
+void TimingConnection::send(const QByteArray &query)
+{
+    const quint64 start = monotonicMicroseconds();
+    connection->send(query);
+    record(Send, start, query.size());
+}
+
+QByteArray TimingConnection::receive(unsigned expected)
+{
+    const quint64 start = monotonicMicroseconds();
+    const QByteArray result = connection->receive(expected);
+    record(Receive, start, result.size());
+    return result;
+}
+
+void TimingConnection::purge()
+{
+    const quint64 start = monotonicMicroseconds();
+    connection->purge();
+    record(Purge, start, 0);
+}
+
+unsigned TimingConnection::receiveData(char *data, unsigned size)
+{
+    const quint64 start = monotonicMicroseconds();
+    const unsigned result = connection->receiveData(data, size);
+    record(Receive, start, result);
+    return result;
+}
+
+void TimingConnection::record(Operation operation, quint64 start,
+        unsigned bytes)
+{
+    const quint64 duration = monotonicMicroseconds() - start;
+    const QString command = currentCommand();
+
+    QMutexLocker locker(&statisticsLock);
+
+    statisticsMaps[operation][command].add(duration, bytes);
+}
+
+QString TimingConnection::currentCommand()
+{
+    return currentCommands.hasLocalData() ? *currentCommands.localData() :
+        QString();
+}
+
+bool TimingConnection::isEnabled()
+{
+    return timingConnections != 0;
+}
+
+QMap<QString, LatencyHistogram> TimingConnection::statistics
+        (Operation operation)
+{
+    QMutexLocker locker(&statisticsLock);
+
+    return statisticsMaps[operation];
+}
+
+void TimingConnection::resetStatistics()
+{
+    QMutexLocker locker(&statisticsLock);
+
+    for (unsigned i = 0; i < OperationCount; ++i)
+        statisticsMaps[i].clear();
+}
+
+QStringList TimingConnection::formatStatistics()
+{
+    QMap<QString, LatencyHistogram> operations[OperationCount];
+    QSet<QString> commands;
+    for (unsigned i = 0; i < OperationCount; ++i) {
+        operations[i] = statistics(Operation(i));
+        commands += operations[i].keys().toSet();
+    }
+    QStringList sortedCommands = commands.toList();
+    qSort(sortedCommands);
+
+    const QString operationNames[OperationCount] = {
+        tr("send"), tr("receive"), tr("purge")
+    };
+
+    QStringList result;
+    Q_FOREACH (const QString &command, sortedCommands) {
+        for (unsigned i = 0; i < OperationCount; ++i) {
+            if (!operations[i].contains(command))
+                continue;
+            const LatencyHistogram &histogram = operations[i][command];
+            QString line = tr("%1 %2: %3 calls, p50 %4, p95 %5, p99 %6")
+                .arg(command.isEmpty() ? tr("(no command)") : command,
+                        operationNames[i])
+                .arg(histogram.count())
+                .arg(milliseconds(histogram.percentile(50)),
+                        milliseconds(histogram.percentile(95)),
+                        milliseconds(histogram.percentile(99)));
+            if (histogram.totalBytes() > 0)
+                line += tr(", %1 bytes/s")
+                    .arg(histogram.throughput(), 0, 'f', 0);
+            result.append(line);
+        }
+    }
+    return result;
+}
+
+} // namespace igotu
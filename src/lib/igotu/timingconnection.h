@@ -0,0 +1,91 @@
+/******************************************************************************
+ * Copyright (C) 2009  Michael Hofmann <mh21@mh21.de>                         *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License along    *
+ * with this program; if not, write to the Free Software Foundation, Inc.,    *
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.                *
+ ******************************************************************************/
+
+#ifndef _IGOTU2GPX_SRC_IGOTU_TIMINGCONNECTION_H_
+#define _IGOTU2GPX_SRC_IGOTU_TIMINGCONNECTION_H_
+
+#include "dataconnection.h"
+#include "latencyhistogram.h"
+
+#include <QCoreApplication>
+#include <QMap>
+#include <QStringList>
+
+#include <boost/scoped_ptr.hpp>
+
+namespace igotu
+{
+
+class IgotuCommand;
+
+// Decorates a data connection and records the durations of all calls,
+// attributed to the command that is executed in the calling thread
+class IGOTU_EXPORT TimingConnection : public DataConnection
+{
+    Q_DECLARE_TR_FUNCTIONS(igotu::TimingConnection)
+public:
+    enum Operation {
+        Send,
+        // receive() and receiveData()
+        Receive,
+        Purge,
+        OperationCount
+    };
+
+    // Attributes timings in the current thread to a command while it exists;
+    // does nothing while no TimingConnection exists
+    class IGOTU_EXPORT CommandScope
+    {
+    public:
+        CommandScope(const IgotuCommand *command);
+        ~CommandScope();
+
+    private:
+        const bool active;
+        QString previous;
+    };
+
+    // Takes ownership of the connection
+    TimingConnection(DataConnection *connection);
+    ~TimingConnection();
+
+    virtual void send(const QByteArray &query);
+    virtual QByteArray receive(unsigned expected);
+    virtual void purge();
+    virtual unsigned receiveData(char *data, unsigned size);
+
+    // name set by the innermost CommandScope in the current thread
+    static QString currentCommand();
+    // whether any TimingConnection exists, i.e. statistics are recorded
+    static bool isEnabled();
+
+    // histograms per command name for an operation, for all connections
+    static QMap<QString, LatencyHistogram> statistics(Operation operation);
+    static void resetStatistics();
+    // one line per command and operation with percentiles and throughput
+    static QStringList formatStatistics();
+
+private:
+    void record(Operation operation, quint64 start, unsigned bytes);
+
+    boost::scoped_ptr<DataConnection> connection;
+};
+
+} // namespace igotu
+
+#endif
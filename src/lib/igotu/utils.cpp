@@ -22,9 +22,18 @@
 
 #include <QMetaProperty>
 #include <QTextStream>
+#include <QThread>
 
 #include <cmath>
 
+#if defined(Q_OS_WIN32)
+    #include <windows.h>
+#elif defined(Q_OS_MAC)
+    #include <sys/time.h>
+#else
+    #include <time.h>
+#endif
+
 namespace igotu
 {
 
@@ -212,6 +221,39 @@ const char *enumValueToKey(const QMetaObject &metaObject,
     return key;
 }
 
+class SleepThread : public QThread
+{
+public:
+    using QThread::usleep;
+};
+
+void sleepMicroseconds(unsigned long usecs)
+{
+    SleepThread::usleep(usecs);
+}
+
+quint64 monotonicMicroseconds()
+{
+#if defined(Q_OS_WIN32)
+    LARGE_INTEGER frequency, counter;
+    if (!QueryPerformanceFrequency(&frequency) ||
+            !QueryPerformanceCounter(&counter))
+        return quint64(GetTickCount()) * 1000;
+    return quint64(counter.QuadPart / frequency.QuadPart) * 1000000 +
+        quint64(counter.QuadPart % frequency.QuadPart) * 1000000 /
+        frequency.QuadPart;
+#elif defined(Q_OS_MAC)
+    // no clock_gettime() on older versions of Mac OS X
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return quint64(tv.tv_sec) * 1000000 + tv.tv_usec;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return quint64(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+#endif
+}
+
 // QColor/QRgb is in QtGui
 static unsigned ahsv(double hue, double s, double v, double a)
 {
@@ -50,6 +50,13 @@ IGOTU_EXPORT const char *enumValueToKey(const QMetaObject &metaObject, const
 IGOTU_EXPORT QString dump(const QByteArray &data);
 IGOTU_EXPORT QString dumpDiff(const QByteArray &oldData, const QByteArray &newData);
 
+// QThread::usleep() is protected in Qt 4
+IGOTU_EXPORT void sleepMicroseconds(unsigned long usecs);
+
+// Monotonic clock with an arbitrary epoch, QTime only has millisecond
+// resolution and follows the wall clock
+IGOTU_EXPORT quint64 monotonicMicroseconds();
+
 } // namespace igotu
 
 #endif
@@ -0,0 +1,285 @@
+/******************************************************************************
+ * Copyright (C) 2009  Michael Hofmann <mh21@mh21.de>                         *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License along    *
+ * with this program; if not, write to the Free Software Foundation, Inc.,    *
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.                *
+ ******************************************************************************/
+
+#include "igotu/exception.h"
+#include "igotu/fileexporter.h"
+#include "igotu/igotucontrol.h"
+#include "igotu/igotudata.h"
+#include "igotu/messages.h"
+#include "igotu/pluginloader.h"
+
+#include "fleetobject.h"
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QVector>
+
+using namespace igotu;
+
+struct FleetDevice
+{
+    enum State {
+        Waiting,
+        Downloading,
+        Skipped,
+        Succeeded,
+        Failed
+    };
+
+    FleetDevice() :
+        control(NULL),
+        serialNumber(0),
+        num(0),
+        total(0),
+        state(Waiting)
+    {
+    }
+
+    IgotuControl *control;
+    QString device;
+    unsigned serialNumber;
+    unsigned num;
+    unsigned total;
+    State state;
+    // file name or error message
+    QString result;
+};
+
+class FleetObjectPrivate : public QObject
+{
+    Q_OBJECT
+public Q_SLOTS:
+    void deviceConnected(const QString &device, uint serialNumber);
+    void commandRunning(uint num, uint total);
+    void commandFailed(const QString &message);
+    void contentsRetrieved(const QByteArray &contents, uint count);
+
+public:
+    // device of the control that emitted the current signal
+    FleetDevice *senderDevice();
+    void finish(FleetDevice *device, FleetDevice::State state,
+            const QString &result);
+    void showProgress();
+
+    QVector<FleetDevice> devices;
+    QList<unsigned> serialNumbers;
+    const FileExporter *exporter;
+    QDir directory;
+    unsigned finished;
+    int shownPercent;
+};
+
+// FleetObjectPrivate ==========================================================
+
+FleetDevice *FleetObjectPrivate::senderDevice()
+{
+    for (unsigned i = 0; i < unsigned(devices.size()); ++i)
+        if (devices[i].control == sender())
+            return &devices[i];
+    return NULL;
+}
+
+void FleetObjectPrivate::deviceConnected(const QString &device,
+        uint serialNumber)
+{
+    Q_UNUSED(device);
+
+    FleetDevice * const fleetDevice = senderDevice();
+    if (!fleetDevice)
+        return;
+    fleetDevice->serialNumber = serialNumber;
+    if (!serialNumbers.isEmpty() && !serialNumbers.contains(serialNumber)) {
+        fleetDevice->state = FleetDevice::Skipped;
+        fleetDevice->control->cancel();
+    } else {
+        fleetDevice->state = FleetDevice::Downloading;
+    }
+}
+
+void FleetObjectPrivate::commandRunning(uint num, uint total)
+{
+    FleetDevice * const device = senderDevice();
+    if (!device)
+        return;
+    device->num = num;
+    device->total = total;
+    showProgress();
+}
+
+void FleetObjectPrivate::commandFailed(const QString &message)
+{
+    FleetDevice * const device = senderDevice();
+    if (!device)
+        return;
+    if (device->state == FleetDevice::Skipped)
+        finish(device, FleetDevice::Skipped, QString());
+    else
+        finish(device, FleetDevice::Failed, message);
+}
+
+void FleetObjectPrivate::contentsRetrieved(const QByteArray &contents,
+        uint count)
+{
+    FleetDevice * const device = senderDevice();
+    if (!device)
+        return;
+    if (device->state == FleetDevice::Skipped) {
+        finish(device, FleetDevice::Skipped, QString());
+        return;
+    }
+
+    const QString fileName = directory.filePath
+        (QString::number(device->serialNumber) + QLatin1Char('.') +
+         exporter->fileExtension());
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly) ||
+            file.write(exporter->save(IgotuData(contents, count),
+                    device->control->tracksAsSegments(),
+                    device->control->utcOffset())) == -1) {
+        finish(device, FleetDevice::Failed, FleetObject::tr
+                ("Unable to write file '%1': %2")
+                .arg(fileName, file.errorString()));
+        return;
+    }
+    finish(device, FleetDevice::Succeeded, fileName);
+}
+
+void FleetObjectPrivate::finish(FleetDevice *device, FleetDevice::State state,
+        const QString &result)
+{
+    device->state = state;
+    device->result = result;
+    ++finished;
+    showProgress();
+
+    if (finished < unsigned(devices.size()))
+        return;
+
+    Messages::normalMessage(QString());
+    bool failed = false;
+    Q_FOREACH (const FleetDevice &fleetDevice, devices) {
+        switch (fleetDevice.state) {
+        case FleetDevice::Succeeded:
+            Messages::normalMessage(FleetObject::tr("%1: saved %2 to '%3'")
+                    .arg(fleetDevice.device).arg(fleetDevice.serialNumber)
+                    .arg(fleetDevice.result));
+            break;
+        case FleetDevice::Skipped:
+            Messages::verboseMessage(FleetObject::tr("%1: skipped %2")
+                    .arg(fleetDevice.device).arg(fleetDevice.serialNumber));
+            break;
+        default:
+            failed = true;
+            Messages::errorMessage(FleetObject::tr("%1: %2")
+                    .arg(fleetDevice.device, fleetDevice.result));
+        }
+    }
+    QCoreApplication::exit(failed ? 1 : 0);
+}
+
+void FleetObjectPrivate::showProgress()
+{
+    // finished devices count as complete
+    double progress = 0;
+    Q_FOREACH (const FleetDevice &device, devices) {
+        if (device.state == FleetDevice::Skipped ||
+                device.state == FleetDevice::Succeeded ||
+                device.state == FleetDevice::Failed)
+            progress += 1;
+        else if (device.total > 0)
+            progress += double(device.num) / device.total;
+    }
+    const int percent = qRound(100 * progress / devices.size());
+    if (percent == shownPercent)
+        return;
+    shownPercent = percent;
+    Messages::normalMessagePart(QLatin1Char('\r') + FleetObject::tr
+            ("Downloading from %1 GPS trackers: %2 finished, %3%")
+            .arg(devices.size()).arg(finished).arg(percent));
+}
+
+// FleetObject =================================================================
+
+FleetObject::FleetObject(const QStringList &devices,
+        const IgotuControl *control) :
+    d(new FleetObjectPrivate)
+{
+    d->exporter = NULL;
+    d->finished = 0;
+    d->shownPercent = -1;
+
+    d->devices.resize(devices.size());
+    for (unsigned i = 0; i < unsigned(devices.size()); ++i) {
+        IgotuControl * const deviceControl = new IgotuControl(this);
+        deviceControl->setDevice(devices[i]);
+        deviceControl->copySettings(control);
+
+        connect(deviceControl,
+                SIGNAL(deviceConnected(QString,uint)),
+                d, SLOT(deviceConnected(QString,uint)));
+        connect(deviceControl, SIGNAL(commandRunning(uint,uint)),
+                d, SLOT(commandRunning(uint,uint)));
+        connect(deviceControl, SIGNAL(commandFailed(QString)),
+                d, SLOT(commandFailed(QString)));
+        connect(deviceControl, SIGNAL(contentsRetrieved(QByteArray,uint)),
+                d, SLOT(contentsRetrieved(QByteArray,uint)));
+
+        d->devices[i].control = deviceControl;
+        d->devices[i].device = devices[i];
+    }
+}
+
+FleetObject::~FleetObject()
+{
+    delete d;
+}
+
+void FleetObject::setSerialNumbers(const QList<unsigned> &serialNumbers)
+{
+    d->serialNumbers = serialNumbers;
+}
+
+void FleetObject::save(const QString &format, const QString &directory)
+{
+    if (d->devices.isEmpty())
+        throw Exception(tr("No GPS trackers found"));
+
+    QMultiMap<int, FileExporter*> exporterMap;
+    Q_FOREACH (FileExporter * const exporter,
+            PluginLoader().availablePlugins<FileExporter>())
+        exporterMap.insert(exporter->exporterPriority(), exporter);
+    Q_FOREACH (FileExporter * const exporter, exporterMap) {
+        if (!d->exporter || format == exporter->formatName())
+            d->exporter = exporter;
+        if (format == exporter->formatName())
+            break;
+    }
+    if (!d->exporter)
+        throw Exception(tr("No file exporters found"));
+
+    d->directory = QDir(directory);
+    if (!d->directory.exists() && !d->directory.mkpath(QLatin1String(".")))
+        throw Exception(tr("Unable to create directory '%1'")
+                .arg(directory));
+
+    Q_FOREACH (const FleetDevice &device, d->devices)
+        device.control->contents();
+}
+
+#include "fleetobject.moc"
@@ -0,0 +1,54 @@
+/******************************************************************************
+ * Copyright (C) 2009  Michael Hofmann <mh21@mh21.de>                         *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License along    *
+ * with this program; if not, write to the Free Software Foundation, Inc.,    *
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.                *
+ ******************************************************************************/
+
+#ifndef _IGOTU2GPX_SRC_IGOTU2GPX_FLEETOBJECT_H_
+#define _IGOTU2GPX_SRC_IGOTU2GPX_FLEETOBJECT_H_
+
+#include <QObject>
+#include <QStringList>
+
+namespace igotu
+{
+class IgotuControl;
+}
+
+class FleetObjectPrivate;
+
+// Downloads several GPS trackers in parallel, one IgotuControl and therefore
+// one worker thread per device
+class FleetObject : public QObject
+{
+    Q_OBJECT
+public:
+    // Settings that are not specific to a device are copied from control
+    FleetObject(const QStringList &devices, const igotu::IgotuControl *control);
+    ~FleetObject();
+
+    // only GPS trackers with these serial numbers are downloaded, all if
+    // empty
+    void setSerialNumbers(const QList<unsigned> &serialNumbers);
+
+    // saves the trackpoints of each GPS tracker to <serial number>.<ext> in
+    // the directory and quits the application when all are finished
+    void save(const QString &format, const QString &directory);
+
+protected:
+    FleetObjectPrivate *d;
+};
+
+#endif
@@ -26,9 +26,14 @@
 #include "igotu/optioncontext.h"
 #include "igotu/paths.h"
 #include "igotu/pluginloader.h"
+#include "igotu/retrypolicy.h"
+#include "igotu/timingconnection.h"
 
+#include "fleetobject.h"
 #include "mainobject.h"
+#include "watchobject.h"
 
+#include <boost/scoped_ptr.hpp>
 #include <boost/shared_ptr.hpp>
 
 #include <QFile>
@@ -96,12 +101,20 @@ int main(int argc, char *argv[])
     QString action;
     QMap<QString, QString> parameters;
     bool segments = false;
+    bool largeReads = false;
+    bool cache = false;
+    QString retryPolicy;
+    bool stats = false;
+    QString progress = QLatin1String("dots");
+    QString serialNumbers;
+    QString outputDirectory = QLatin1String(".");
+    bool purge = false;
     bool version = false;
     int verbose = 0;
     int offset = 0;
 
     OptionContext context(app.arguments(),
-            MainObject::tr("info|dump|config|clear|reset|diff [OPTION...]"),
+            MainObject::tr("info|dump|config|clear|reset|diff|fleet|watch [OPTION...]"),
             OptionGroup(QString(), Common::tr("Program Options"), QString(),
                 QString(), QList<OptionEntry>()
              << OptionEntry(QLatin1String("action"), 0, 0,
@@ -122,7 +135,13 @@ int main(int argc, char *argv[])
                  MainObject::tr("reset: reset the GPS tracker to factory defaults")
                  + QLatin1Char('\n') +
                  //: Do not translate the word before the colon
-                 MainObject::tr("diff: show configuration differences relative to an image file"),
+                 MainObject::tr("diff: show configuration differences relative to an image file")
+                 + QLatin1Char('\n') +
+                 //: Do not translate the word before the colon
+                 MainObject::tr("fleet: save trackpoints of all attached GPS trackers")
+                 + QLatin1Char('\n') +
+                 //: Do not translate the word before the colon
+                 MainObject::tr("watch: save info and trackpoints of GPS trackers when they are attached"),
                  MainObject::tr("ACTION"))
              << OptionEntry(QLatin1String("device"), QLatin1Char('d'), 0,
                  OptionEntry::RequiredArgument, &device,
@@ -130,6 +149,19 @@ int main(int argc, char *argv[])
                      "(usb:<vendor>:<product> (Unix) or serial:<n> "
                      "(Windows))"),
                  MainObject::tr("DEVICE"))
+             << OptionEntry(QLatin1String("serial-number"), 0, 0,
+                 OptionEntry::RequiredArgument, &serialNumbers,
+                 MainObject::tr("only use the GPS tracker with this serial "
+                     "number (fleet, watch: comma separated list)"),
+                 MainObject::tr("NUMBER"))
+             << OptionEntry(QLatin1String("output-dir"), 0, 0,
+                 OptionEntry::RequiredArgument, &outputDirectory,
+                 MainObject::tr("directory for the files saved by fleet and watch"),
+                 MainObject::tr("DIR"))
+             << OptionEntry(QLatin1String("purge"), 0, 0,
+                 OptionEntry::NoArgument, &purge,
+                 MainObject::tr("watch: clear the memory of the GPS tracker "
+                     "after the saved files have been verified"))
              << OptionEntry(QLatin1String("image"), QLatin1Char('i'), 0,
                  OptionEntry::RequiredArgument, &imagePath,
                  MainObject::tr("read memory contents from file "
@@ -152,6 +184,30 @@ int main(int argc, char *argv[])
                  OptionEntry::RequiredArgument, &offset,
                  MainObject::tr("time zone offset in seconds"),
                  MainObject::tr("SECONDS"))
+             << OptionEntry(QLatin1String("large-reads"), 0, 0,
+                 OptionEntry::NoArgument, &largeReads,
+                 MainObject::tr("download trackpoints with larger reads if "
+                     "supported by the GPS tracker"))
+             << OptionEntry(QLatin1String("cache"), 0, 0,
+                 OptionEntry::NoArgument, &cache,
+                 MainObject::tr("only download trackpoints that are not yet "
+                     "in the download cache"))
+             << OptionEntry(QLatin1String("retry-policy"), 0, 0,
+                 OptionEntry::RequiredArgument, &retryPolicy,
+                 MainObject::tr("retries and delays for failed commands, "
+                     "comma separated (default: %1)")
+                 .arg(IgotuControl::defaultRetryPolicy().toString()),
+                 MainObject::tr("PARAM=VALUE,..."))
+             << OptionEntry(QLatin1String("stats"), 0, 0,
+                 OptionEntry::NoArgument, &stats,
+                 MainObject::tr("print latency percentiles and throughput "
+                     "for each command and flash busy times at the end"))
+             << OptionEntry(QLatin1String("progress"), 0, 0,
+                 OptionEntry::RequiredArgument, &progress,
+                 MainObject::tr("progress output: dots or one JSON object "
+                     "per line with phase, bytes, rates and remaining time "
+                     "(json)"),
+                 MainObject::tr("FORMAT"))
             << OptionEntry(QLatin1String("version"), 0, 0,
                  OptionEntry::NoArgument, &version,
                  Common::tr("output version information and exit"))
@@ -204,9 +260,41 @@ int main(int argc, char *argv[])
                 QString::fromAscii(contents.toBase64());
         }
 
+        if (progress != QLatin1String("dots") &&
+                progress != QLatin1String("json"))
+            throw Exception(MainObject::tr("Unknown progress format: %1")
+                    .arg(progress));
+
         Messages::setVerbose(verbose);
 
         MainObject mainObject(device, segments, offset);
+        mainObject.control()->setLargeReads(largeReads);
+        mainObject.control()->setDownloadCache(cache);
+        mainObject.control()->setRetryPolicy
+            (RetryPolicy::fromString(retryPolicy));
+        mainObject.control()->setConnectionStatistics(stats);
+        mainObject.setJsonProgress(progress == QLatin1String("json"));
+
+        QList<unsigned> serialNumberList;
+        Q_FOREACH (const QString &number, serialNumbers.split(QLatin1Char(','),
+                    QString::SkipEmptyParts)) {
+            bool ok;
+            serialNumberList.append(number.toUInt(&ok));
+            if (!ok)
+                throw Exception(MainObject::tr("Invalid serial number: %1")
+                        .arg(number));
+        }
+        // Only fleet and watch handle several GPS trackers
+        if (serialNumberList.size() > 1 &&
+                action != QLatin1String("fleet") &&
+                action != QLatin1String("watch"))
+            throw Exception(MainObject::tr("Only fleet and watch accept "
+                        "several serial numbers: %1").arg(serialNumbers));
+        if (!serialNumberList.isEmpty())
+            mainObject.control()->setSerialNumber(serialNumberList.first());
+
+        boost::scoped_ptr<FleetObject> fleetObject;
+        boost::scoped_ptr<WatchObject> watchObject;
 
         if (action == QLatin1String("info")) {
             mainObject.info();
@@ -231,11 +319,48 @@ int main(int argc, char *argv[])
                     configParams.insert(part.section(QLatin1Char('='), 0, 0),
                             part.section(QLatin1Char('='), 1));
             mainObject.configure(configParams);
+        } else if (action == QLatin1String("fleet")) {
+            fleetObject.reset(new FleetObject(IgotuControl::availableDevices(),
+                        mainObject.control()));
+            fleetObject->setSerialNumbers(serialNumberList);
+            fleetObject->save(format, outputDirectory);
+        } else if (action == QLatin1String("watch")) {
+            watchObject.reset(new WatchObject(mainObject.control()));
+            watchObject->setSerialNumbers(serialNumberList);
+            watchObject->setPurge(purge);
+            watchObject->watch(format.split(QLatin1Char(','),
+                        QString::SkipEmptyParts), outputDirectory);
         } else {
             throw Exception(MainObject::tr("Unknown action: %1")
                     .arg(action));
         }
-        return app.exec();
+        const int result = app.exec();
+
+        typedef QMap<QString, unsigned> RetryCounts;
+        const RetryCounts protocolRetries =
+            RetryPolicy::retryCounts(RetryPolicy::ProtocolError);
+        for (RetryCounts::const_iterator i = protocolRetries.begin();
+                i != protocolRetries.end(); ++i)
+            Messages::verboseMessage(MainObject::tr
+                    ("%1: %2 retries after protocol errors")
+                    .arg(i.key()).arg(i.value()));
+        const RetryCounts deviceRetries =
+            RetryPolicy::retryCounts(RetryPolicy::DeviceError);
+        for (RetryCounts::const_iterator i = deviceRetries.begin();
+                i != deviceRetries.end(); ++i)
+            Messages::verboseMessage(MainObject::tr
+                    ("%1: %2 retries after device errors")
+                    .arg(i.key()).arg(i.value()));
+
+        if (stats) {
+            Q_FOREACH (const QString &line,
+                    TimingConnection::formatStatistics())
+                Messages::normalMessage(line);
+            Q_FOREACH (const QString &line, IgotuControl::writeStatistics())
+                Messages::normalMessage(line);
+        }
+
+        return result;
     } catch (const std::exception &e) {
         Messages::errorMessage(MainObject::tr("Error: %1")
                     .arg(QString::fromLocal8Bit(e.what())));
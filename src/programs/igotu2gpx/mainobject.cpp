@@ -45,43 +45,96 @@ public Q_SLOTS:
 
     void on_control_infoRetrieved(const QString &info, const QByteArray &contents);
     void on_control_contentsRetrieved(const QByteArray &contents, uint count);
+    void on_control_progressChanged(const igotu::Progress &progress);
 
 public:
+    // One JSON object per line with the given event and additional members
+    void jsonEvent(const QString &event, const QString &members = QString());
+
     MainObject *p;
 
     IgotuControl *control;
     QByteArray contents;
     QString format;
     QList<FileExporter*> exporters;
+    bool jsonProgress;
 };
 
+static QString jsonString(const QString &text)
+{
+    QString result(QLatin1Char('"'));
+    Q_FOREACH (const QChar &c, text) {
+        if (c == QLatin1Char('"') || c == QLatin1Char('\\')) {
+            result += QLatin1Char('\\');
+            result += c;
+        } else if (c.unicode() < 0x20 || c.unicode() > 0x7e) {
+            result += QString::fromLatin1("\\u%1")
+                .arg(c.unicode(), 4, 16, QLatin1Char('0'));
+        } else {
+            result += c;
+        }
+    }
+    return result + QLatin1Char('"');
+}
+
 // Put translations in the right context
 //
 // TRANSLATOR igotu::Common
 
 // MainObjectPrivate ===========================================================
 
+void MainObjectPrivate::jsonEvent(const QString &event,
+        const QString &members)
+{
+    QString line = QLatin1String("{\"event\":") + jsonString(event);
+    if (!members.isEmpty())
+        line += QLatin1Char(',') + members;
+    Messages::normalMessage(line + QLatin1Char('}'));
+}
+
 void MainObjectPrivate::on_control_commandStarted(const QString &message)
 {
-    Messages::normalMessagePart(message);
+    if (jsonProgress)
+        jsonEvent(QLatin1String("started"),
+                QLatin1String("\"message\":") + jsonString(message));
+    else
+        Messages::normalMessagePart(message);
 }
 
 void MainObjectPrivate::on_control_commandRunning(uint num, uint total)
 {
     Q_UNUSED(num);
     Q_UNUSED(total);
-    Messages::normalMessagePart(QLatin1String("."));
+    if (!jsonProgress)
+        Messages::normalMessagePart(QLatin1String("."));
+}
+
+void MainObjectPrivate::on_control_progressChanged
+    (const igotu::Progress &progress)
+{
+    if (jsonProgress)
+        jsonEvent(QLatin1String("progress"),
+                QLatin1String("\"progress\":") + progress.toJson());
 }
 
 void MainObjectPrivate::on_control_commandFailed(const QString &message)
 {
+    if (jsonProgress) {
+        // stderr only carries the JSON stream
+        jsonEvent(QLatin1String("failed"),
+                QLatin1String("\"message\":") + jsonString(message));
+        return;
+    }
     Messages::normalMessage(QString());
     Messages::errorMessage(message);
 }
 
 void MainObjectPrivate::on_control_commandSucceeded()
 {
-    Messages::normalMessage(QString());
+    if (jsonProgress)
+        jsonEvent(QLatin1String("succeeded"));
+    else
+        Messages::normalMessage(QString());
 }
 
 void MainObjectPrivate::on_control_infoRetrieved(const QString &info,
@@ -120,6 +173,7 @@ MainObject::MainObject(const QString &device, bool tracksAsSegments, int utcOffs
     d(new MainObjectPrivate)
 {
     d->p = this;
+    d->jsonProgress = false;
 
     QMultiMap<int, FileExporter*> exporterMap;
     Q_FOREACH (FileExporter * const exporter,
@@ -144,6 +198,16 @@ MainObject::~MainObject()
     delete d;
 }
 
+IgotuControl *MainObject::control() const
+{
+    return d->control;
+}
+
+void MainObject::setJsonProgress(bool jsonProgress)
+{
+    d->jsonProgress = jsonProgress;
+}
+
 void MainObject::info(const QByteArray &contents)
 {
     d->contents = contents;
@@ -22,6 +22,11 @@
 #include <QObject>
 #include <QVariantMap>
 
+namespace igotu
+{
+class IgotuControl;
+}
+
 class MainObjectPrivate;
 
 class MainObject : public QObject
@@ -31,6 +36,11 @@ public:
     MainObject(const QString &device, bool tracksAsSegments, int utcOffset);
     ~MainObject();
 
+    igotu::IgotuControl *control() const;
+
+    // progress as JSON lines on stderr instead of dots
+    void setJsonProgress(bool jsonProgress);
+
     void info(const QByteArray &contents = QByteArray());
     void save(const QString &format);
     void purge();
@@ -0,0 +1,326 @@
+/******************************************************************************
+ * Copyright (C) 2009  Michael Hofmann <mh21@mh21.de>                         *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License along    *
+ * with this program; if not, write to the Free Software Foundation, Inc.,    *
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.                *
+ ******************************************************************************/
+
+#include "igotu/devicemonitor.h"
+#include "igotu/exception.h"
+#include "igotu/fileexporter.h"
+#include "igotu/igotucontrol.h"
+#include "igotu/igotudata.h"
+#include "igotu/messages.h"
+#include "igotu/pluginloader.h"
+
+#include "watchobject.h"
+
+#include <boost/shared_ptr.hpp>
+
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+
+using namespace igotu;
+
+struct WatchDevice
+{
+    enum Stage {
+        Info,
+        Contents,
+        Purge,
+        // also for skipped and failed GPS trackers, nothing is done until
+        // they are attached again
+        Done
+    };
+
+    WatchDevice() :
+        control(NULL),
+        serialNumber(0),
+        stage(Info)
+    {
+    }
+
+    IgotuControl *control;
+    QString device;
+    unsigned serialNumber;
+    // file name without extension
+    QString baseName;
+    Stage stage;
+};
+
+class WatchObjectPrivate : public QObject
+{
+    Q_OBJECT
+public Q_SLOTS:
+    void deviceArrived(const QString &device);
+    void deviceRemoved(const QString &device);
+
+    void deviceConnected(const QString &device, uint serialNumber);
+    void commandSucceeded();
+    void commandFailed(const QString &message);
+    void infoRetrieved(const QString &info, const QByteArray &contents);
+    void contentsRetrieved(const QByteArray &contents, uint count);
+
+public:
+    // device of the control that emitted the current signal
+    WatchDevice *senderDevice();
+    // Writes data to the file and reads it back, returns false on errors
+    static bool writeVerified(const QString &fileName, const QByteArray &data,
+            QString *error);
+
+    WatchObject *p;
+
+    const IgotuControl *settings;
+    DeviceMonitor monitor;
+    QList<boost::shared_ptr<WatchDevice> > devices;
+    QList<unsigned> serialNumbers;
+    bool purge;
+    QList<const FileExporter*> exporters;
+    QDir directory;
+};
+
+// WatchObjectPrivate ==========================================================
+
+WatchDevice *WatchObjectPrivate::senderDevice()
+{
+    Q_FOREACH (const boost::shared_ptr<WatchDevice> &device, devices)
+        if (device->control == sender())
+            return device.get();
+    return NULL;
+}
+
+bool WatchObjectPrivate::writeVerified(const QString &fileName,
+        const QByteArray &data, QString *error)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size() ||
+            !file.flush()) {
+        *error = file.errorString();
+        return false;
+    }
+    file.close();
+    if (!file.open(QIODevice::ReadOnly)) {
+        *error = file.errorString();
+        return false;
+    }
+    if (file.readAll() != data) {
+        *error = WatchObject::tr("File contents differ after writing");
+        return false;
+    }
+    return true;
+}
+
+void WatchObjectPrivate::deviceArrived(const QString &device)
+{
+    boost::shared_ptr<WatchDevice> watchDevice(new WatchDevice);
+    watchDevice->device = device;
+    watchDevice->control = new IgotuControl(this);
+    watchDevice->control->setDevice(device);
+    watchDevice->control->copySettings(settings);
+
+    connect(watchDevice->control,
+            SIGNAL(deviceConnected(QString,uint)),
+            this, SLOT(deviceConnected(QString,uint)));
+    connect(watchDevice->control, SIGNAL(commandSucceeded()),
+            this, SLOT(commandSucceeded()));
+    connect(watchDevice->control, SIGNAL(commandFailed(QString)),
+            this, SLOT(commandFailed(QString)));
+    connect(watchDevice->control, SIGNAL(infoRetrieved(QString,QByteArray)),
+            this, SLOT(infoRetrieved(QString,QByteArray)));
+    connect(watchDevice->control, SIGNAL(contentsRetrieved(QByteArray,uint)),
+            this, SLOT(contentsRetrieved(QByteArray,uint)));
+    devices.append(watchDevice);
+
+    Messages::normalMessage(WatchObject::tr("%1: attached").arg(device));
+    watchDevice->control->info();
+}
+
+void WatchObjectPrivate::deviceRemoved(const QString &device)
+{
+    for (unsigned i = 0; i < unsigned(devices.size()); ++i) {
+        if (devices[i]->device != device)
+            continue;
+        if (devices[i]->stage != WatchDevice::Done)
+            Messages::errorMessage(WatchObject::tr
+                    ("%1: removed before all files were saved")
+                    .arg(device));
+        else
+            Messages::normalMessage(WatchObject::tr("%1: removed")
+                    .arg(device));
+        // waits for running tasks that will fail without the device
+        devices[i]->control->deleteLater();
+        devices.removeAt(i);
+        return;
+    }
+}
+
+void WatchObjectPrivate::deviceConnected(const QString &device,
+        uint serialNumber)
+{
+    Q_UNUSED(device);
+
+    WatchDevice * const watchDevice = senderDevice();
+    if (!watchDevice)
+        return;
+    watchDevice->serialNumber = serialNumber;
+    // a new file for every download, older ones may have been cleared
+    watchDevice->baseName = directory.filePath(QString::number(serialNumber) +
+            QLatin1Char('-') + QDateTime::currentDateTime()
+            .toString(QLatin1String("yyyyMMdd-hhmmss")));
+    if (!serialNumbers.isEmpty() && !serialNumbers.contains(serialNumber)) {
+        Messages::normalMessage(WatchObject::tr("%1: skipped GPS tracker %2")
+                .arg(watchDevice->device).arg(serialNumber));
+        watchDevice->stage = WatchDevice::Done;
+    }
+}
+
+void WatchObjectPrivate::commandSucceeded()
+{
+    WatchDevice * const device = senderDevice();
+    if (!device || device->stage != WatchDevice::Purge)
+        return;
+    device->stage = WatchDevice::Done;
+    Messages::normalMessage(WatchObject::tr("%1: memory of GPS tracker %2 "
+                "cleared").arg(device->device).arg(device->serialNumber));
+}
+
+void WatchObjectPrivate::commandFailed(const QString &message)
+{
+    WatchDevice * const device = senderDevice();
+    if (!device || device->stage == WatchDevice::Done)
+        return;
+    device->stage = WatchDevice::Done;
+    Messages::errorMessage(WatchObject::tr("%1: %2")
+            .arg(device->device, message));
+}
+
+void WatchObjectPrivate::infoRetrieved(const QString &info,
+        const QByteArray &contents)
+{
+    Q_UNUSED(contents);
+
+    WatchDevice * const device = senderDevice();
+    if (!device || device->stage != WatchDevice::Info)
+        return;
+
+    QString error;
+    const QString fileName = device->baseName + QLatin1String("-info.txt");
+    if (!writeVerified(fileName, info.toUtf8(), &error)) {
+        device->stage = WatchDevice::Done;
+        Messages::errorMessage(WatchObject::tr
+                ("%1: Unable to write file '%2': %3")
+                .arg(device->device, fileName, error));
+        return;
+    }
+
+    device->stage = WatchDevice::Contents;
+    device->control->contents();
+}
+
+void WatchObjectPrivate::contentsRetrieved(const QByteArray &contents,
+        uint count)
+{
+    WatchDevice * const device = senderDevice();
+    if (!device || device->stage != WatchDevice::Contents)
+        return;
+
+    const IgotuData data(contents, count);
+    Q_FOREACH (const FileExporter * const exporter, exporters) {
+        QString error;
+        const QString fileName = device->baseName + QLatin1Char('.') +
+            exporter->fileExtension();
+        if (!writeVerified(fileName, exporter->save(data,
+                        device->control->tracksAsSegments(),
+                        device->control->utcOffset()), &error)) {
+            device->stage = WatchDevice::Done;
+            Messages::errorMessage(WatchObject::tr
+                    ("%1: Unable to write file '%2': %3")
+                    .arg(device->device, fileName, error));
+            return;
+        }
+        Messages::normalMessage(WatchObject::tr("%1: saved '%2'")
+                .arg(device->device, fileName));
+    }
+
+    if (!purge || count == 0) {
+        device->stage = WatchDevice::Done;
+        return;
+    }
+    device->stage = WatchDevice::Purge;
+    device->control->purge();
+}
+
+// WatchObject =================================================================
+
+WatchObject::WatchObject(const IgotuControl *control) :
+    d(new WatchObjectPrivate)
+{
+    d->p = this;
+    d->settings = control;
+    d->purge = false;
+
+    connect(&d->monitor, SIGNAL(deviceArrived(QString)),
+            d, SLOT(deviceArrived(QString)));
+    connect(&d->monitor, SIGNAL(deviceRemoved(QString)),
+            d, SLOT(deviceRemoved(QString)));
+}
+
+WatchObject::~WatchObject()
+{
+    delete d;
+}
+
+void WatchObject::setSerialNumbers(const QList<unsigned> &serialNumbers)
+{
+    d->serialNumbers = serialNumbers;
+}
+
+void WatchObject::setPurge(bool purge)
+{
+    d->purge = purge;
+}
+
+void WatchObject::watch(const QStringList &formats, const QString &directory)
+{
+    QMultiMap<int, FileExporter*> exporterMap;
+    Q_FOREACH (FileExporter * const exporter,
+            PluginLoader().availablePlugins<FileExporter>())
+        exporterMap.insert(exporter->exporterPriority(), exporter);
+    if (exporterMap.isEmpty())
+        throw Exception(tr("No file exporters found"));
+
+    d->exporters.clear();
+    if (formats.isEmpty())
+        d->exporters.append(exporterMap.values().first());
+    Q_FOREACH (const QString &format, formats) {
+        const FileExporter *selected = NULL;
+        Q_FOREACH (const FileExporter * const exporter, exporterMap)
+            if (exporter->formatName() == format)
+                selected = exporter;
+        if (!selected)
+            throw Exception(tr("Unknown format: %1").arg(format));
+        d->exporters.append(selected);
+    }
+
+    d->directory = QDir(directory);
+    if (!d->directory.exists() && !d->directory.mkpath(QLatin1String(".")))
+        throw Exception(tr("Unable to create directory '%1'")
+                .arg(directory));
+
+    Messages::normalMessage(tr("Waiting for GPS trackers..."));
+    d->monitor.start();
+}
+
+#include "watchobject.moc"
@@ -0,0 +1,56 @@
+/******************************************************************************
+ * Copyright (C) 2009  Michael Hofmann <mh21@mh21.de>                         *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License along    *
+ * with this program; if not, write to the Free Software Foundation, Inc.,    *
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.                *
+ ******************************************************************************/
+
+#ifndef _IGOTU2GPX_SRC_IGOTU2GPX_WATCHOBJECT_H_
+#define _IGOTU2GPX_SRC_IGOTU2GPX_WATCHOBJECT_H_
+
+#include <QObject>
+#include <QStringList>
+
+namespace igotu
+{
+class IgotuControl;
+}
+
+class WatchObjectPrivate;
+
+// Resident mode that downloads every GPS tracker as soon as it is attached
+class WatchObject : public QObject
+{
+    Q_OBJECT
+public:
+    // Settings that are not specific to a device are copied from control
+    WatchObject(const igotu::IgotuControl *control);
+    ~WatchObject();
+
+    // only GPS trackers with these serial numbers are downloaded, all if
+    // empty
+    void setSerialNumbers(const QList<unsigned> &serialNumbers);
+    // clear the memory after all files have been written and read back
+    void setPurge(bool purge);
+
+    // saves info and trackpoints of each attached GPS tracker to
+    // <serial number>-<time>.<ext> in the directory, once per format; runs
+    // until the application is quit
+    void watch(const QStringList &formats, const QString &directory);
+
+protected:
+    WatchObjectPrivate *d;
+};
+
+#endif
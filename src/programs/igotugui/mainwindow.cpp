@@ -43,6 +43,7 @@
 #include <QPushButton>
 #include <QStyle>
 #include <QTabWidget>
+#include <QTime>
 #include <QTimer>
 
 using namespace igotu;
@@ -70,6 +71,9 @@ public Q_SLOTS:
 
     void on_control_infoRetrieved(const QString &info, const QByteArray &contents);
     void on_control_contentsRetrieved(const QByteArray &contents, uint count);
+    void on_control_contentsBlockRetrieved(const QByteArray &block,
+            uint offset);
+    void on_control_progressChanged(const igotu::Progress &current);
 
     void on_update_newVersionAvailable(const QString &version,
             const QString &name, const QUrl &url);
@@ -85,6 +89,7 @@ public:
     void abortBackgroundAction(const QString &text);
 
 private:
+    void setVisualizerTracks(const IgotuPoints &points);
     QString savedTrackFileName(bool raw, const IgotuPoint &point,
             FileExporter **currentExporter);
     void saveTracks(const QList<QList<IgotuPoint> > &tracks);
@@ -93,11 +98,16 @@ public:
     MainWindow *p;
 
     boost::scoped_ptr<IgotuData> lastTrackPoints;
+    // trackpoints of the running download
+    IgotuPoints streamedPoints;
+    QTime streamedUpdate;
     boost::scoped_ptr<IgotuConfig> lastConfig;
     boost::scoped_ptr<Ui::MainWindow> ui;
     IgotuControl *control;
     UpdateNotification *update;
     QProgressBar *progress;
+    // status bar message of the running command
+    QString backgroundMessage;
     QPointer<PreferencesDialog> preferences;
     PluginLoader *pluginLoader;
     QList<TrackVisualizer*> visualizers;
@@ -303,10 +313,44 @@ void MainWindowPrivate::on_control_contentsRetrieved(const QByteArray &contents,
     lastTrackPoints.reset(new IgotuData(contents, count));
     lastConfig.reset(new IgotuConfig(lastTrackPoints->config()));
     ui->actionSaveAll->setEnabled(count > 0);
+    streamedPoints = IgotuPoints();
 
+    setVisualizerTracks(lastTrackPoints->points());
+}
+
+void MainWindowPrivate::on_control_contentsBlockRetrieved
+    (const QByteArray &block, uint offset)
+{
+    // The first block contains the configuration
+    if (offset == 0) {
+        streamedPoints = IgotuPoints();
+        streamedUpdate.start();
+        return;
+    }
+
+    streamedPoints.append(block);
+    // Showing all tracks again for every block would slow down the download
+    if (streamedUpdate.elapsed() < 1000)
+        return;
+    streamedUpdate.restart();
+    setVisualizerTracks(streamedPoints);
+}
+
+void MainWindowPrivate::on_control_progressChanged
+    (const igotu::Progress &current)
+{
+    // Late updates after the command finished would hide its result
+    if (!ui->actionCancel->isEnabled())
+        return;
+    p->statusBar()->showMessage(backgroundMessage + QLatin1Char(' ') +
+            current.toString());
+}
+
+void MainWindowPrivate::setVisualizerTracks(const IgotuPoints &points)
+{
     Q_FOREACH (TrackVisualizer *visualizer, visualizers) {
         try {
-            visualizer->setTracks(lastTrackPoints->points(), control->utcOffset());
+            visualizer->setTracks(points, control->utcOffset());
         } catch (const std::exception &e) {
             qCritical("Unable to set tracks in visualizer: %s", e.what());
         }
@@ -319,6 +363,7 @@ void MainWindowPrivate::startBackgroundAction(const QString &text)
     ui->actionReload->setEnabled(false);
     ui->actionPurge->setEnabled(false);
     ui->actionConfigureTracker->setEnabled(false);
+    backgroundMessage = text;
     p->statusBar()->showMessage(text);
 }
 
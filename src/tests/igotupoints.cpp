@@ -0,0 +1,44 @@
+/******************************************************************************
+ * Copyright (C) 2009  Michael Hofmann <mh21@mh21.de>                         *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License along    *
+ * with this program; if not, write to the Free Software Foundation, Inc.,    *
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.                *
+ ******************************************************************************/
+
+#include "igotu/igotupoints.h"
+
+#include "tests.h"
+
+using namespace igotu;
+
+void Tests::igotuPoints()
+{
+    const QByteArray record(0x20, '\x01');
+    const QByteArray erased(0x20, '\xff');
+
+    IgotuPoints points;
+    QCOMPARE(points.points().size(), 0);
+
+    points.append(record + record);
+    QCOMPARE(points.points().size(), 2);
+
+    // the first erased record ends the trackpoints
+    points.append(record + erased + record);
+    QCOMPARE(points.points().size(), 3);
+    points.append(record);
+    QCOMPARE(points.points().size(), 3);
+
+    const IgotuPoints complete(record + record + record + erased, 3);
+    QCOMPARE(points.points().size(), complete.points().size());
+}
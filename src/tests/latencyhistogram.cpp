@@ -0,0 +1,50 @@
+/******************************************************************************
+ * Copyright (C) 2009  Michael Hofmann <mh21@mh21.de>                         *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License along    *
+ * with this program; if not, write to the Free Software Foundation, Inc.,    *
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.                *
+ ******************************************************************************/
+
+#include "igotu/latencyhistogram.h"
+
+#include "tests.h"
+
+using namespace igotu;
+
+void Tests::latencyHistogram()
+{
+    LatencyHistogram histogram;
+    QCOMPARE(histogram.percentile(50), quint64(0));
+
+    for (unsigned i = 1; i <= 100; ++i)
+        histogram.add(i * 100, 10);
+    QCOMPARE(histogram.count(), 100u);
+    QCOMPARE(histogram.totalBytes(), quint64(1000));
+    QCOMPARE(histogram.throughput(), 1000 * 1e6 / histogram.totalTime());
+
+    // buckets are at most 12.5% wide
+    QVERIFY(histogram.percentile(50) >= 5000);
+    QVERIFY(histogram.percentile(50) <= 5625);
+    QVERIFY(histogram.percentile(99) >= 9900);
+    QCOMPARE(histogram.percentile(100), quint64(10000));
+
+    // small values are exact
+    LatencyHistogram small;
+    small.add(3);
+    small.add(7);
+    QCOMPARE(small.percentile(50), quint64(3));
+    histogram.add(small);
+    QCOMPARE(histogram.count(), 102u);
+    QCOMPARE(histogram.percentile(0), quint64(3));
+}
@@ -0,0 +1,50 @@
+/******************************************************************************
+ * Copyright (C) 2009  Michael Hofmann <mh21@mh21.de>                         *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License along    *
+ * with this program; if not, write to the Free Software Foundation, Inc.,    *
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.                *
+ ******************************************************************************/
+
+#include "igotu/progress.h"
+
+#include "tests.h"
+
+using namespace igotu;
+
+void Tests::progress()
+{
+    Progress progress;
+    progress.start(Progress::Read, 0x3000, 1000000);
+    QCOMPARE(progress.eta(), -1);
+    QCOMPARE(progress.phaseName(), QString::fromLatin1("read"));
+
+    // 4 KiB/s
+    progress.update(0x1000, 2000000);
+    QCOMPARE(progress.bytes(), quint64(0x1000));
+    QCOMPARE(progress.elapsed(), 1000u);
+    QCOMPARE(progress.averageRate(), 4096.0);
+    QCOMPARE(progress.currentRate(), 4096.0);
+    QCOMPARE(progress.eta(), 2);
+
+    // 8 KiB/s, the current rate is smoothed over about two seconds
+    progress.update(0x3000, 3000000);
+    QVERIFY(progress.currentRate() > 4096.0);
+    QVERIFY(progress.currentRate() < 8192.0);
+    QCOMPARE(progress.eta(), 0);
+
+    QCOMPARE(progress.toJson(), QString::fromLatin1
+            ("{\"phase\":\"read\",\"bytes\":12288,\"total\":12288,"
+             "\"rate\":%1,\"average\":6144,\"eta\":0}")
+            .arg(progress.currentRate(), 0, 'f', 0));
+}
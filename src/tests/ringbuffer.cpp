@@ -0,0 +1,52 @@
+/******************************************************************************
+ * Copyright (C) 2009  Michael Hofmann <mh21@mh21.de>                         *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License along    *
+ * with this program; if not, write to the Free Software Foundation, Inc.,    *
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.                *
+ ******************************************************************************/
+
+#include "igotu/ringbuffer.h"
+
+#include "tests.h"
+
+using namespace igotu;
+
+void Tests::ringBuffer()
+{
+    RingBuffer buffer(4);
+    QVERIFY(buffer.isEmpty());
+
+    // wraps around the end
+    buffer.append("abc", 3);
+    char data[16];
+    QCOMPARE(buffer.read(data, 2), 2u);
+    ARRAYCOMP(data, "ab", 2);
+    buffer.append("def", 3);
+    QCOMPARE(buffer.size(), 4u);
+    QCOMPARE(buffer.read(data, 16), 4u);
+    ARRAYCOMP(data, "cdef", 4);
+    QVERIFY(buffer.isEmpty());
+
+    // grows while wrapped
+    buffer.append("ghi", 3);
+    QCOMPARE(buffer.skip(2), 2u);
+    buffer.append(QByteArray("jklmnop"));
+    QCOMPARE(buffer.size(), 8u);
+    QCOMPARE(buffer.read(data, 16), 8u);
+    ARRAYCOMP(data, "ijklmnop", 8);
+
+    buffer.append("qr", 2);
+    buffer.clear();
+    QCOMPARE(buffer.read(data, 16), 0u);
+}
@@ -37,6 +37,10 @@ class Tests: public QObject
     Q_OBJECT
 private Q_SLOTS:
     void igotuConfig();
+    void igotuPoints();
+    void latencyHistogram();
+    void progress();
+    void ringBuffer();
 };
 
 #endif